@@ -1,15 +1,52 @@
-$input v_texcoord0, v_texcoord1, v_normal, v_position, v_color0
+$input v_texcoord0, v_texcoord1, v_repeat, v_normal, v_position, v_color0
 
 #include "common.sc"
 
+#define OCCM_DECL_UNIFORMS
+#define OCCM_GHOST_ONLY
+SAMPLER3D(s_occm_ghost, 1);
+#include "occlusion_map.sc"
+
 SAMPLER2D(s_tex, 0);
 
 uniform vec4 u_color;
 uniform vec4 u_alpha;
 uniform vec4 u_flags_id;
+uniform vec4 u_tile_unit;
+
+// x: if nonzero, ghost tiles are resolved, otherwise ignored
+// y: if nonzero, only fragments of ghost tiles are drawn, otherwise only
+//    fragments of non-ghost tiles are
+// z: if nonzero, only fragments whose neighbor across the face is a ghost
+//    tile are drawn
+// see ChunkRenderer::Pass
+uniform vec4 u_ghost;
+
+// distance off of a face to sample the tile it belongs to/faces
+#define GHOST_EPSILON 0.01
 
 void main() {
-    vec4 color = texture2D(s_tex, v_texcoord0);
+    if (u_ghost.x > 0.5) {
+        vec3 n = (v_normal * 2.0) - 1.0;
+        bool
+            ghost = occm_sample_ghost(v_position - (n * GHOST_EPSILON)),
+            ghost_n = occm_sample_ghost(v_position + (n * GHOST_EPSILON));
+
+        if (ghost != (u_ghost.y > 0.5) || (u_ghost.z > 0.5 && !ghost_n)) {
+            discard;
+        }
+    }
+
+    // wrap texture coordinates of merged faces, gradients are taken from the
+    // unwrapped coordinates so that there are no seams between repeats
+    vec2
+        r = fract(v_repeat),
+        st = v_texcoord0 + (r * u_tile_unit.xy),
+        st_specular = v_texcoord1 + (r * u_tile_unit.zw),
+        d_x = dFdx(v_repeat * u_tile_unit.xy),
+        d_y = dFdy(v_repeat * u_tile_unit.xy);
+
+    vec4 color = texture2DGrad(s_tex, st, d_x, d_y);
 
     if (color.a < EPSILON) {
         discard;
@@ -18,7 +55,7 @@ void main() {
     WRITE_GBUFFERS(
         vec4(mix(color.rgb, u_color.rgb, u_color.a), u_alpha.a),
         v_normal,
-        texture2D(s_tex, v_texcoord1).r,
+        texture2DGrad(s_tex, st_specular, d_x, d_y).r,
         uint(u_flags_id.x),
         uint(u_flags_id.y),
         int(u_flags_id.y) == 0 ? 0 : v_color0);
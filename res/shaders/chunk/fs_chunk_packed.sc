@@ -0,0 +1 @@
+#include "fs_chunk.sc"
@@ -1,10 +1,13 @@
 $input a_position, a_normal, a_texcoord0, a_texcoord1, a_color0
-$output v_texcoord0, v_texcoord1, v_normal, v_position, v_color0
+$output v_texcoord0, v_texcoord1, v_repeat, v_normal, v_position, v_color0
 
 #include "common.sc"
 
 uniform vec4 u_render_flags;
 
+// size of one tile texture in the atlas (xy: texture, zw: specular)
+uniform vec4 u_tile_unit;
+
 DECL_CAMERA_UNIFORMS(u_cvp)
 
 void main() {
@@ -22,8 +25,13 @@ void main() {
 
     gl_Position = mul(mvp, vec4(a_position, 1.0));
 
-    v_texcoord0 = a_texcoord0;
-    v_texcoord1 = a_texcoord1;
+    // texture coordinates are passed as the origin of the face texture and
+    // a (repeating) position on the face, see ChunkVertex::pack_tile_id
+    vec2 corner = vec2(a_color0.zw >> 7);
+    vec2 repeat = vec2(a_color0.zw & 0x7Fu) + 1.0;
+    v_texcoord0 = a_texcoord0 - (corner * u_tile_unit.xy);
+    v_texcoord1 = a_texcoord1 - (corner * u_tile_unit.zw);
+    v_repeat = corner * repeat;
     //v_color0 = uint(a_color0);
     v_normal = normalize(mul(u_model[0], vec4(a_normal, 0.0)).xyz) * 0.5 + 0.5;
     v_position = mul(u_model[0], vec4(a_position, 1.0)).xyz;
@@ -0,0 +1,57 @@
+$input a_color1, a_color2
+$output v_texcoord0, v_texcoord1, v_repeat, v_normal, v_position, v_color0
+
+#include "common.sc"
+
+// face textures (xy: texture, zw: specular), see ChunkRenderer::face_index
+BUFFER_RO(u_chunk_faces, vec4, 8); // BUFFER_INDEX_CHUNK_FACES
+
+uniform vec4 u_render_flags;
+
+DECL_CAMERA_UNIFORMS(u_cvp)
+
+// normal of Direction::Enum d
+vec3 direction_normal(uint d) {
+    float s = (d & 1u) == 0u ? 1.0 : -1.0;
+
+    if (d < 2u) {
+        return vec3(0.0, 0.0, s);
+    } else if (d < 4u) {
+        return vec3(s, 0.0, 0.0);
+    }
+
+    return vec3(0.0, s, 0.0);
+}
+
+void main() {
+    mat4 mvp;
+
+    bool
+        base_pass = (uint(u_render_flags.x) & RENDER_FLAG_PASS_BASE) != 0,
+        cvp = (uint(u_render_flags.x) & RENDER_FLAG_CVP) != 0;
+
+    if (base_pass && cvp) {
+        mvp = mul(u_cvp_viewProj, u_model[0]);
+    } else {
+        mvp = mul(u_viewProj, u_model[0]);
+    }
+
+    // see ChunkVertexPacked for layout
+    vec3 position = vec3(a_color1.xyz);
+    uint d = a_color1.w & 7u;
+    vec2 corner = vec2((uvec2(a_color1.w, a_color1.w) >> uvec2(3, 4)) & 1u);
+    vec4 face = u_chunk_faces[a_color2.x | (a_color2.y << 8)];
+    vec2 repeat = vec2(a_color2.zw) + 1.0;
+
+    gl_Position = mul(mvp, vec4(position, 1.0));
+
+    // same outputs as vs_chunk: origin of face texture and a (repeating)
+    // position on the face
+    v_texcoord0 = face.xy;
+    v_texcoord1 = face.zw;
+    v_repeat = corner * repeat;
+    v_normal =
+        normalize(mul(u_model[0], vec4(direction_normal(d), 0.0)).xyz)
+            * 0.5 + 0.5;
+    v_position = mul(u_model[0], vec4(position, 1.0)).xyz;
+}
@@ -113,13 +113,16 @@ vec3 sunlight(vec3 view_dir, vec3 pos_w, vec3 n, float shine) {
 vec3 light(vec3 view_dir, vec3 pos_w, vec3 n_w, float shine) {
     vec3 result;
 
-    for (uint i = 0; i < MAX_LIGHTS; i++) {
+    // only lights binned into this pixel's cluster can reach it
+    uint offset, count;
+    get_light_cluster(pos_w, offset, count);
+
+    for (uint i = 0; i < count; i++) {
         Light l;
-        get_light(i, l);
+        get_light(get_light_index(offset + i), l);
 
-        // light not present, must be last in array
         if (!l.present) {
-            break;
+            continue;
         }
 
         vec3 vec_l = l.position - pos_w;
@@ -127,7 +130,7 @@ vec3 light(vec3 view_dir, vec3 pos_w, vec3 n_w, float shine) {
         float att = 1.0 / (l.att.x + l.att.y * dist + l.att.z * (dist * dist));
 
         // attenutation so low light is unnoticable
-        if (att < 0.01) {
+        if (att < LIGHT_ATTENUATION_CUTOFF) {
             continue;
         }
 
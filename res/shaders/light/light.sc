@@ -13,6 +13,15 @@
 #ifdef DECL_LIGHT_UNIFORMS
 // TODO: BUFFER_INDEX_LIGHT
 BUFFER_RO(LIGHT_UNIFORM_NAME, vec4, 2);
+
+// TODO: BUFFER_INDEX_LIGHT_CLUSTERS
+// (offset, count) pairs for each cell, two per vec4, followed by light indices,
+// four per vec4 (see LightClusters)
+BUFFER_RO(u_light_clusters, vec4, 7);
+
+// [0] = (grid min x, grid min z, cell size, -)
+// [1] = (cells x, cells z, start of light indices in u_light_clusters, -)
+uniform vec4 u_light_grid[2];
 #endif
 
 struct Light {
@@ -37,6 +46,32 @@ void get_light(uint i, out Light l) {
     l.specular  = LIGHT_UNIFORM_NAME[base + 4].rgb;
 }
 
+// get index list (offset, count) of lights which can reach pos_w
+void get_light_cluster(vec3 pos_w, out uint offset, out uint count) {
+    vec2 dims = u_light_grid[1].xy;
+    if (dims.x < 1.0) {
+        offset = 0;
+        count = 0;
+        return;
+    }
+
+    vec2 cell =
+        clamp(
+            floor((floor(pos_w.xz) - u_light_grid[0].xy) / u_light_grid[0].z),
+            vec2(0.0),
+            dims - 1.0);
+    uint i = uint((cell.y * dims.x) + cell.x);
+    vec4 v = u_light_clusters[i / 2];
+    offset = uint((i % 2) == 0 ? v.x : v.z);
+    count = uint((i % 2) == 0 ? v.y : v.w);
+}
+
+// get light index at position k of cluster index lists
+uint get_light_index(uint k) {
+    vec4 v = u_light_clusters[uint(u_light_grid[1].z) + (k / 4)];
+    return uint(v[k % 4]);
+}
+
 #endif
 
 #endif
@@ -6,6 +6,7 @@
 #define OCCM_FULL_SAMPLER_NAME s_occm_full
 #define OCCM_TOP_SAMPLER_NAME s_occm_top
 #define OCCM_BLOCKING_SAMPLER_NAME s_occm_blocking
+#define OCCM_GHOST_SAMPLER_NAME s_occm_ghost
 #define OCCM_OFFSET_UNIFORM_NAME u_occm_offset
 #define OCCM_SIZE_UNIFORM_NAME u_occm_size
 
@@ -35,6 +36,22 @@ vec2 _occm_sample_pos_2d(vec2 pos_xz_w) {
     return q;
 }
 
+// only occm_sample_ghost() is declared (and its sampler needed) if
+// OCCM_GHOST_ONLY is defined, otherwise only the others are
+#ifdef OCCM_GHOST_ONLY
+// true if tile at pos_w is a ghost, false if outside of occlusion map
+bool occm_sample_ghost(vec3 pos_w) {
+    vec3 q = pos_w - OCCM_OFFSET_UNIFORM_NAME.xyz;
+    if (any(lessThan(q, vec3(0.0)))
+            || any(greaterThanEqual(q, OCCM_SIZE_UNIFORM_NAME.xyz))) {
+        return false;
+    }
+
+    return texture3D(
+        OCCM_GHOST_SAMPLER_NAME,
+        _occm_sample_pos_3d(pos_w)).r > EPSILON;
+}
+#else
 bool occm_sample(vec3 pos_w) {
     return texture3D(
         OCCM_FULL_SAMPLER_NAME,
@@ -93,6 +110,7 @@ bool occm_raycast(
 
     return false;
 }
+#endif // ifdef OCCM_GHOST_ONLY
 
 #endif // ifndef __cplusplus
 #endif // ifndef OCCLUSION_MAP_SC
@@ -9,10 +9,13 @@
 // graphics configuration
 #define SHADOW_SAMPLES 8
 #define SSAO_SAMPLES 16
-#define MAX_LIGHTS 1024
+#define MAX_LIGHTS 4096
 
 #define LIGHT_MAX_VALUE 15
 
+// attenuation below which a light no longer contributes to a pixel
+#define LIGHT_ATTENUATION_CUTOFF 0.01
+
 // graphics flags
 #define GFX_FLAG_NONE               0
 #define GFX_FLAG_WATER              (1 << 0)
@@ -51,6 +54,8 @@
 #define BUFFER_INDEX_SPRITE             4
 #define BUFFER_INDEX_INSTANCE           5
 #define BUFFER_INDEX_INSTANCE_DATA      6
+#define BUFFER_INDEX_LIGHT_CLUSTERS     7
+#define BUFFER_INDEX_CHUNK_FACES        8
 
 // used to represent invalid indices which ought to generate VERTEX_INVALID in
 // the vertex shader
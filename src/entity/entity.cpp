@@ -18,9 +18,9 @@ static void remove_from_current_chunk(Entity &entity) {
         return;
     }
 
-    entity.chunk->get_xz_entities(Level::to_chunk_pos(entity.last_tile).xz())
-        .erase(&entity);
-    entity.chunk->entities.erase(&entity);
+    entity.chunk->remove_entity(
+        entity, Level::to_chunk_pos(entity.last_tile).xz());
+    entity.chunk = nullptr;
 }
 
 // run whenever entity position is changed
@@ -53,6 +53,16 @@ static void check_tile_change(Entity &entity, bool create = false) {
 
     const auto offset = Level::to_offset(entity.tile);
 
+    // entities are parked at the edge of unloaded chunks (streaming levels)
+    // rather than leaving their current chunk: go back to the last position,
+    // which is still in it
+    if (!create && entity.level->is_chunk_unloaded(offset)) {
+        entity.pos = entity.last_pos;
+        entity.velocity = vec3(0.0f);
+        check_pos_change(entity, true);
+        return;
+    }
+
     if (!entity.level->contains_chunk(offset)) {
         WARN("Entity {} moved out of level, disappearing!", entity.id);
         entity.destroy();
@@ -64,15 +74,14 @@ static void check_tile_change(Entity &entity, bool create = false) {
         auto *chunk = entity.level->chunkp(offset);
         remove_from_current_chunk(entity);
         entity.chunk = chunk;
-        entity.chunk->entities.insert(&entity);
-        entity.chunk->get_xz_entities(
-            Level::to_chunk_pos(entity.tile).xz()).insert(&entity);
+        entity.chunk->add_entity(
+            entity, Level::to_chunk_pos(entity.tile).xz());
     } else {
-        // move xz entities in current chunk
-        entity.chunk->get_xz_entities(
-            Level::to_chunk_pos(entity.last_tile).xz()).erase(&entity);
-        entity.chunk->get_xz_entities(
-            Level::to_chunk_pos(entity.tile).xz()).insert(&entity);
+        // move between cells in current chunk
+        entity.chunk->move_entity(
+            entity,
+            Level::to_chunk_pos(entity.last_tile).xz(),
+            Level::to_chunk_pos(entity.tile).xz());
     }
 
     entity.last_tile = entity.tile;
@@ -294,6 +303,15 @@ vec3 Entity::move(const vec3 &movement) {
             }
         }
 
+        // unloaded chunks are solid
+        for (const auto &p : aabb_new.points()) {
+            if (this->level->is_chunk_unloaded(
+                    Level::to_offset(Level::to_tile(p.xz())))) {
+                inside = false;
+                break;
+            }
+        }
+
         if (inside) {
             aabb_current = aabb_new;
         }
@@ -31,6 +31,10 @@ struct Entity {
     // offset when spawning entities so as to not collide with underlying tile
     static constexpr auto COLLISION_OFFSET = vec3(0.0f, 0.001f, 0.0f);
 
+    // margin around aabb() (or pos) which rendered geometry can reach into,
+    // i.e. animated limbs and held items
+    static constexpr auto RENDER_MARGIN = vec3(1.0f);
+
     // unique id
     EntityId id = NO_ENTITY;
 
@@ -42,6 +46,17 @@ struct Entity {
     [[SERIALIZE_IGNORE]]
     Chunk *chunk = nullptr;
 
+    // index of this entity in chunk->entities
+    [[SERIALIZE_IGNORE]]
+    usize chunk_index = 0;
+
+    // links in chunk spatial index cell list, see Chunk::cell_heads
+    [[SERIALIZE_IGNORE]]
+    Entity *cell_prev = nullptr;
+
+    [[SERIALIZE_IGNORE]]
+    Entity *cell_next = nullptr;
+
     // entity positions
     vec3 pos, last_pos, pos_delta, center;
 
@@ -171,6 +186,12 @@ struct Entity {
     // returns AABB if it entity has one
     virtual std::optional<AABB> aabb() const { return std::nullopt; }
 
+    // returns bounds of everything this entity renders, used for culling
+    virtual AABB render_aabb() const {
+        const auto aabb = this->aabb().value_or(AABB(this->pos, this->pos));
+        return AABB(aabb.min - RENDER_MARGIN, aabb.max + RENDER_MARGIN);
+    }
+
     // returns true if gravity applies to this entity
     virtual bool has_gravity() const { return true; }
 
@@ -195,9 +216,13 @@ struct Entity {
     // called when this entity collides with another
     virtual void on_collision(Entity &other) {}
 
-    // get lights for this entity
+    // get lights for this entity, only used if can_emit_light() is true
     virtual LightArray lights() const;
 
+    // used to enable light gathering for this entity, must not change over
+    // the entity's lifetime
+    virtual bool can_emit_light() const { return false; }
+
     // returns true if this entity should be highlighted by the cursor
     virtual bool highlight() const { return false; }
 };
@@ -6,6 +6,8 @@ struct EntityEmberParticle : public EntitySmokeParticle {
     using Base = EntitySmokeParticle;
     using Base::Base;
 
+    bool can_emit_light() const override { return true; }
+
     LightArray lights() const override {
         auto light =
             Light(
@@ -40,6 +40,8 @@ struct EntityItem : public Entity {
 
     LightArray lights() const override;
 
+    bool can_emit_light() const override { return true; }
+
     bool does_collide(const Entity &other) const override {
         return true;
     }
@@ -71,6 +71,8 @@ struct EntityMob :
 
     LightArray lights() const override;
 
+    bool can_emit_light() const override { return true; }
+
     virtual Side::Enum side_hold() const {
         return Side::LEFT;
     }
@@ -8,3 +8,9 @@ DECL_SERIALIZER(EntityModeled)
 std::optional<AABB> EntityModeled::aabb() const {
     return this->model().entity_aabb(*this).translate(this->pos);
 }
+
+AABB EntityModeled::render_aabb() const {
+    return AABB::merge(
+        Base::render_aabb(),
+        this->model().aabb().translate(this->pos));
+}
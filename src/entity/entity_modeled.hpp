@@ -13,4 +13,7 @@ struct EntityModeled : virtual public Entity {
     virtual const ModelEntity &model() const = 0;
 
     std::optional<AABB> aabb() const override;
+
+    // includes the whole model, which can be larger than its entity_aabb()
+    AABB render_aabb() const override;
 };
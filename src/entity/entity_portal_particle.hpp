@@ -41,6 +41,8 @@ struct EntityPortalParticle : public EntityParticle {
                 a * math::cos(t) * RADIUS);
     }
 
+    bool can_emit_light() const override { return true; }
+
     LightArray lights() const override {
         auto light =
             Light(
@@ -36,6 +36,8 @@ struct EntityShrine
 
     LightArray lights() const override;
 
+    bool can_emit_light() const override { return true; }
+
     const ModelShrine &model() const override;
 
     void tick() override;
@@ -102,6 +102,69 @@ static GameCamera::Frustum compute_frustum(const GameCamera &camera) {
     return frustum;
 }
 
+void GameCamera::Frustum::cull(
+    std::span<const AABB> boxes,
+    std::span<u8> dst) const {
+    ASSERT(dst.size() >= boxes.size());
+
+    constexpr auto N = CULL_BATCH;
+
+    // plane offsets along their normals, v is in front of p if
+    // dot(v, p.n) >= d
+    std::array<f32, 4> ds;
+    for (usize i = 0; i < this->planes.size(); i++) {
+        ds[i] = math::dot(this->planes[i].c, this->planes[i].n);
+    }
+
+    for (usize i = 0; i < boxes.size(); i += N) {
+        const auto n = std::min(N, boxes.size() - i);
+
+        // transpose into lanes, the last batch is padded with its last box
+        std::array<f32, N> min_x, min_y, min_z, max_x, max_y, max_z;
+        for (usize j = 0; j < N; j++) {
+            const auto &b = boxes[i + std::min(j, n - 1)];
+            min_x[j] = b.min.x;
+            min_y[j] = b.min.y;
+            min_z[j] = b.min.z;
+            max_x[j] = b.max.x;
+            max_y[j] = b.max.y;
+            max_z[j] = b.max.z;
+        }
+
+        // overlap with rough box
+        std::array<u8, N> in;
+        #pragma omp simd
+        for (usize j = 0; j < N; j++) {
+            in[j] =
+                (min_x[j] <= this->box.max.x)
+                & (min_y[j] <= this->box.max.y)
+                & (min_z[j] <= this->box.max.z)
+                & (max_x[j] >= this->box.min.x)
+                & (max_y[j] >= this->box.min.y)
+                & (max_z[j] >= this->box.min.z);
+        }
+
+        // corner furthest along each plane's normal must be in front of it,
+        // which corner that is depends only on the plane
+        for (usize k = 0; k < this->planes.size(); k++) {
+            const auto &p = this->planes[k];
+            const auto
+                &xs = p.n.x >= 0.0f ? max_x : min_x,
+                &ys = p.n.y >= 0.0f ? max_y : min_y,
+                &zs = p.n.z >= 0.0f ? max_z : min_z;
+
+            #pragma omp simd
+            for (usize j = 0; j < N; j++) {
+                in[j] &=
+                    ((xs[j] * p.n.x) + (ys[j] * p.n.y) + (zs[j] * p.n.z))
+                        >= ds[k];
+            }
+        }
+
+        std::copy(in.begin(), in.begin() + n, dst.begin() + i);
+    }
+}
+
 void GameCamera::follow(const Entity &entity) {
     const auto target =
         math::xz_to_xyz(
@@ -264,6 +327,13 @@ std::optional<std::tuple<ivec3, Direction::Enum, vec3>> GameCamera::tile_at(
     const auto res =
         ray.intersect_block(
             [&](const ivec3 &pos) {
+                // nothing solid above the column's solid height
+                if (pos.y < 0
+                        || pos.y >= isize(
+                            this->level->height_solid(pos.xz()))) {
+                    return false;
+                }
+
                 return
                     Tiles::get()[this->level->tiles[pos]]
                         .solid(*this->level, pos);
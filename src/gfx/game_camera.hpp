@@ -39,9 +39,36 @@ struct GameCamera {
             return box.contains(v);
         }
 
+        // true if any part of box may be within frustum
+        inline bool contains(const AABB &box) const {
+            // box is outside if its corner furthest along a plane's normal
+            // is still behind it
+            for (const auto &p : this->planes) {
+                const auto v =
+                    math::mix(
+                        box.min, box.max,
+                        math::greaterThanEqual(p.n, vec3(0.0f)));
+                if (math::dot(v - p.c, p.n) < 0.0f) {
+                    return false;
+                }
+            }
+
+            return math::all(math::lessThanEqual(box.min, this->box.max))
+                && math::all(math::greaterThanEqual(box.max, this->box.min));
+        }
+
         inline AABB aabb() const {
             return this->box;
         }
+
+        // number of boxes tested together by cull()
+        static constexpr usize CULL_BATCH = 8;
+
+        // batch version of contains(AABB): dst[i] is set to 1 if any part of
+        // boxes[i] may be within frustum, 0 otherwise. boxes are transposed
+        // CULL_BATCH at a time so that each plane test is vectorized. points
+        // can be tested as boxes with min == max.
+        void cull(std::span<const AABB> boxes, std::span<u8> dst) const;
     };
 
     enum Rotation {
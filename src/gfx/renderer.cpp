@@ -27,6 +27,7 @@
 #include "util/stack_allocator.hpp"
 #include "platform/platform.hpp"
 #include "platform/window.hpp"
+#include "level/light_clusters.hpp"
 #include "occlusion_map.hpp"
 #include "constants.hpp"
 #include "global.hpp"
@@ -535,7 +536,8 @@ void Renderer::composite(
     RenderFn render_ui,
     const Sun &sun,
     const OcclusionMap &occlusion_map,
-    std::span<Light> lights) {
+    std::span<Light> lights,
+    const LightClusters &clusters) {
     // update texture readers
     this->data_reader->update();
     this->ex_reader->update();
@@ -652,6 +654,7 @@ void Renderer::composite(
 
     // upload lights
     Light::set_uniforms(light, lights);
+    clusters.set_uniforms(light);
 
     light.try_set("s_gbuffer", 0, this->textures["gbuffer"]);
     light.try_set("s_normal", 1, this->textures["normal"]);
@@ -13,6 +13,7 @@
 #include "util/util.hpp"
 
 struct Light;
+struct LightClusters;
 struct OcclusionMap;
 struct GameCamera;
 struct ParticleRenderer;
@@ -152,7 +153,8 @@ struct Renderer {
         RenderFn render_ui,
         const Sun &sun,
         const OcclusionMap &occlusion_map,
-        std::span<Light> lights);
+        std::span<Light> lights,
+        const LightClusters &clusters);
 
     void submit(
         const Program &program,
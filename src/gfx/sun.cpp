@@ -56,6 +56,47 @@ void Sun::update(
     this->camera.update();
 }
 
+// light space bounds of world space box. view is rigid, so the extents are
+// rotated by the absolute value of its rotation.
+static AABB to_light_space(const mat4 &view, const AABB &box) {
+    const auto center = vec3(view * vec4(box.center(), 1.0f));
+    const auto extent =
+        mat3(
+            math::abs(vec3(view[0])),
+            math::abs(vec3(view[1])),
+            math::abs(vec3(view[2])))
+            * (box.size() / 2.0f);
+    return AABB(center - extent, center + extent);
+}
+
+bool Sun::Casters::contains(const AABB &box) const {
+    const auto box_v = to_light_space(this->view, box);
+
+    // must overlap receivers when projected along the light direction and
+    // reach at least as far toward the light (+z) as the furthest receiver
+    return box_v.min.x <= this->receivers.max.x
+        && box_v.max.x >= this->receivers.min.x
+        && box_v.min.y <= this->receivers.max.y
+        && box_v.max.y >= this->receivers.min.y
+        && box_v.max.z >= this->receivers.min.z;
+}
+
+Sun::Casters Sun::casters(const AABB &receivers, f32 max_y) const {
+    Casters result;
+    result.view = this->camera.view;
+    result.receivers = to_light_space(result.view, receivers);
+
+    // casters are at most receivers swept toward the sun until they are
+    // above max_y
+    const auto t =
+        this->direction.y < 0.0f ?
+            math::max(max_y - receivers.min.y, 0.0f) / -this->direction.y
+            : 0.0f;
+    result.bounds =
+        AABB::merge(receivers, receivers.translate(-this->direction * t));
+    return result;
+}
+
 UniformValueList &Sun::uniforms(UniformValueList &dst) const {
     this->camera.uniforms(dst, "u_look_sun");
     dst.set("u_sun_direction", vec4(this->direction, 0.0));
@@ -10,6 +10,23 @@ struct Texture;
 struct Program;
 
 struct Sun {
+    // set of shadow casters which can shade some receivers: everything which
+    // projects (along the sun direction) onto the receivers and is not
+    // entirely behind them, relative to the sun
+    struct Casters {
+        // world -> light space, looking along the sun direction (-z)
+        mat4 view;
+
+        // receiver bounds in light space
+        AABB receivers;
+
+        // world space bounds of all possible casters
+        AABB bounds;
+
+        // true if any part of world space box may cast a shadow on receivers
+        bool contains(const AABB &box) const;
+    };
+
     Camera camera;
     vec3 direction;
     vec3 diffuse, ambient;
@@ -18,5 +35,9 @@ struct Sun {
 
     void update(const Texture &depth, const Camera &camera);
 
+    // shadow casters for world space receivers, assuming nothing is higher
+    // than max_y
+    Casters casters(const AABB &receivers, f32 max_y) const;
+
     UniformValueList &uniforms(UniformValueList &dst) const;
 };
@@ -104,6 +104,7 @@ void ItemIconTile::render(
         group.inherit(group_old);
         group.group_flags &= ~RenderGroup::INSTANCED;
         group.uniforms.set("u_color", vec4(0.0));
+        group.uniforms.set("u_ghost", vec4(0.0));
         group.program = &Renderer::get().programs["chunk"];
 
         auto m = ctx.allocator->alloc<mat4>(model);
@@ -9,6 +9,7 @@
 #include "util/time.hpp"
 #include "util/types.hpp"
 #include "serialize/serialize.hpp"
+#include "serialize/palette_array.hpp"
 #include "global.hpp"
 
 SERIALIZE_ENABLE()
@@ -53,7 +54,7 @@ Chunk::Chunk(Level &level, ivec2 offset)
       offset(offset),
       offset_tiles(ivec3(offset.x, 0, offset.y) * SIZE) {
     init(*this);
-    std::memset(&this->data, 0, sizeof(this->data));
+    this->data.fill(0);
 }
 
 void Chunk::on_after_serialize(SerializationContext &ctx, Archive &a) {
@@ -87,43 +88,186 @@ void Chunk::on_after_deserialize(SerializationContext &ctx, Archive &a) {
 
 void Chunk::on_resolve(SerializationContext &ctx) {
     init(*this);
+
+    for (isize x = 0; x < Chunk::SIZE.x; x++) {
+        for (isize z = 0; z < Chunk::SIZE.z; z++) {
+            this->update_heights(ivec2(x, z));
+        }
+    }
+
+    // rebuild summary from scratch
+    this->summary = Summary();
+    this->tickable.clear();
+    this->emitters.clear();
+    this->extras.clear();
+    for (usize i = 0; i < Chunk::VOLUME; i++) {
+        this->summarize(
+            Chunk::Offset::from_raw(static_cast<u16>(i)),
+            0,
+            this->data.get(i));
+    }
 }
 
 void Chunk::update() {
-    for (auto *e : this->entities) {
-        e->update();
+    // index-based as entities can be added during iteration
+    for (usize i = 0; i < this->entities.size(); i++) {
+        this->entities[i]->update();
     }
 }
 
 void Chunk::tick() {
     auto rand = Rand(hash(this->offset, global.time->ticks));
 
-    // number of random ticks in entire chunk per tick
-    const auto n =
-        (VOLUME * Level::RANDOM_TICKS_PER_MINUTE) /
-            (TICKS_PER_SECOND * 60);
-
-    for (usize i = 0; i < n; i++) {
-        const auto pos = ivec3(
-            rand.next(0, Chunk::SIZE.x - 1),
-            rand.next(0, Chunk::SIZE.y - 1),
-            rand.next(0, Chunk::SIZE.z - 1));
-
-        const auto proxy = this->raw[pos];
-        const TileId tile = Chunk::TileData::from(proxy);
+    // expected number of random ticks per tile per tick
+    constexpr auto rate =
+        static_cast<f64>(
+            (VOLUME * Level::RANDOM_TICKS_PER_MINUTE) /
+                (TICKS_PER_SECOND * 60))
+            / VOLUME;
+
+    // sample only from tickable tiles, keeping the same expected rate per
+    // tile as sampling the entire chunk volume
+    const auto expected = rate * this->tickable.size();
+    auto n = static_cast<usize>(expected);
+    if (rand.chance(expected - n)) {
+        n++;
+    }
 
-        if (tile == 0) {
-            continue;
-        }
+    // NOTE: tickable can change as tiles are ticked
+    for (usize i = 0; i < n && !this->tickable.empty(); i++) {
+        const auto index = rand.pick(this->tickable);
+        const TileId tile = Chunk::TileData::from(this->raw[index]);
+        const ivec3 pos = Offset::from_raw(index);
 
         Tiles::get()[tile].random_tick(
             *this->level,
             this->offset_tiles + pos);
     }
 
-    for (auto *e : this->entities) {
-        e->tick();
+    for (usize i = 0; i < this->entities.size(); i++) {
+        this->entities[i]->tick();
+    }
+
+    // periodically shrink data palette, staggered across chunks
+    if (((global.time->ticks + hash(this->offset))
+            % Chunk::COMPACT_INTERVAL_TICKS) == 0) {
+        this->data.compact();
+    }
+}
+
+// add/remove value from unordered list xs if present changed
+template <typename T>
+static void track(std::vector<T> &xs, const T &x, bool was, bool is) {
+    if (was == is) {
+        return;
+    } else if (is) {
+        xs.push_back(x);
+        return;
+    }
+
+    auto it = std::find(xs.begin(), xs.end(), x);
+    ASSERT(it != xs.end());
+    *it = xs.back();
+    xs.pop_back();
+}
+
+void Chunk::add_entity(Entity &e, const ivec2 &tile) {
+    e.chunk_index = this->entities.size();
+    this->entities.push_back(&e);
+
+    // link at head of cell
+    const auto i = Chunk::to_cell(tile);
+    e.cell_prev = nullptr;
+    e.cell_next = this->cell_heads[i];
+
+    if (e.cell_next) {
+        e.cell_next->cell_prev = &e;
+    }
+
+    this->cell_heads[i] = &e;
+    this->cell_counts[i]++;
+
+    track(this->light_entities, &e, false, e.can_emit_light());
+}
+
+void Chunk::remove_entity(Entity &e, const ivec2 &tile) {
+    ASSERT(
+        e.chunk_index < this->entities.size()
+            && this->entities[e.chunk_index] == &e);
+
+    // swap-remove from entities
+    auto *back = this->entities.back();
+    this->entities[e.chunk_index] = back;
+    back->chunk_index = e.chunk_index;
+    this->entities.pop_back();
+
+    // unlink from cell
+    const auto i = Chunk::to_cell(tile);
+    if (e.cell_prev) {
+        e.cell_prev->cell_next = e.cell_next;
+    } else {
+        ASSERT(this->cell_heads[i] == &e);
+        this->cell_heads[i] = e.cell_next;
+    }
+
+    if (e.cell_next) {
+        e.cell_next->cell_prev = e.cell_prev;
     }
+
+    e.cell_prev = nullptr;
+    e.cell_next = nullptr;
+    this->cell_counts[i]--;
+
+    track(this->light_entities, &e, e.can_emit_light(), false);
+}
+
+void Chunk::move_entity(Entity &e, const ivec2 &from, const ivec2 &to) {
+    const auto i = Chunk::to_cell(from), j = Chunk::to_cell(to);
+
+    if (i == j) {
+        return;
+    }
+
+    if (e.cell_prev) {
+        e.cell_prev->cell_next = e.cell_next;
+    } else {
+        this->cell_heads[i] = e.cell_next;
+    }
+
+    if (e.cell_next) {
+        e.cell_next->cell_prev = e.cell_prev;
+    }
+
+    this->cell_counts[i]--;
+
+    e.cell_prev = nullptr;
+    e.cell_next = this->cell_heads[j];
+
+    if (e.cell_next) {
+        e.cell_next->cell_prev = &e;
+    }
+
+    this->cell_heads[j] = &e;
+    this->cell_counts[j]++;
+}
+
+usize Chunk::num_entities(
+    const ivec2 &tile,
+    std::optional<EntityFilterFn> filter) const {
+    const auto i = Chunk::to_cell(tile);
+
+    if (!filter) {
+        return this->cell_counts[i];
+    }
+
+    usize n = 0;
+    for (auto *e = this->cell_heads[i]; e; e = e->cell_next) {
+        if ((*filter)(*e)) {
+            n++;
+        }
+    }
+
+    return n;
 }
 
 std::tuple<usize, bool> Chunk::get_entities(
@@ -131,9 +275,10 @@ std::tuple<usize, bool> Chunk::get_entities(
     const ivec2 &tile,
     std::optional<EntityFilterFn> filter) const {
     usize n = 0;
-    const auto &xze = this->xz_entities[tile.x * Chunk::SIZE.z + tile.y];
 
-    for (auto *e : xze) {
+    for (auto *e = this->cell_heads[Chunk::to_cell(tile)];
+         e;
+         e = e->cell_next) {
         if (filter && !(*filter)(*e)) {
             continue;
         }
@@ -185,57 +330,33 @@ std::tuple<usize, bool> Chunk::lights(
     const AABB2i &bounds) const {
     usize n = 0;
 
-    // tiles
-    bool overflow = false;
-    f_area(
-        AABBi(
-            math::xz_to_xyz(bounds.min, 0),
-            math::xz_to_xyz(bounds.max, Chunk::SIZE.y - 1)),
-        [&](const ivec3 &pos) {
-            if (overflow) {
-                return;
-            }
-
-            const auto proxy = this->raw[pos];
-            const auto tile_id = Chunk::TileData::from(proxy);
-
-            if (tile_id == 0) {
-                return;
-            }
-
-            const auto flags = Chunk::FlagsData::from(proxy);
-            if (!(flags & TF_LIGHT)) {
-                return;
-            }
-
-            const auto &tile = Tiles::get()[tile_id];
-            const auto lights =
-                tile.lights(
-                    *this->level, this->offset_tiles + pos);
+    // tiles, from emitter registry
+    for (const auto index : this->emitters) {
+        const ivec3 pos = Offset::from_raw(index);
+        if (!bounds.contains(pos.xz())) {
+            continue;
+        }
 
-            for (const auto &l : lights) {
-                if (n >= dest.size()) {
-                    overflow = true;
-                    return;
-                }
+        const auto &tile =
+            Tiles::get()[Chunk::TileData::from(this->data.get(index))];
+        const auto lights =
+            tile.lights(*this->level, this->offset_tiles + pos);
 
-                dest[n++] = l;
+        for (const auto &l : lights) {
+            if (n >= dest.size()) {
+                return std::make_tuple(n, true);
             }
-        });
 
-    if (overflow) {
-        return std::make_tuple(n, true);
+            dest[n++] = l;
+        }
     }
 
-    // get entity lights
-    auto entities =
-        global.frame_allocator.alloc_span<Entity*>(
-            this->num_entities(bounds),
-            Allocator::F_CALLOC);
-
-    this->get_entities(entities, bounds);
+    // entities, bounded by the tile they are tracked on
+    for (const auto *e : this->light_entities) {
+        if (!bounds.contains(Level::to_chunk_pos(e->last_tile).xz())) {
+            continue;
+        }
 
-    for (const auto *e : entities) {
         for (const auto &l : e->lights()) {
             if (n >= dest.size()) {
                 return std::make_tuple(n, true);
@@ -252,12 +373,17 @@ std::tuple<usize, bool> Chunk::offsets_with_flags(
     std::span<ivec3> dest,
     const AABB2i &bounds,
     Chunk::FlagsType flags) const {
+    if (!this->summary.has_flags(flags)) {
+        return std::make_tuple(0, false);
+    }
+
     usize n = 0;
     bool overflow = false;
     f_area(
-        AABBi(
-            math::xz_to_xyz(bounds.min, 0),
-            math::xz_to_xyz(bounds.max, Chunk::SIZE.y - 1)),
+        this->summary.clamp(
+            AABBi(
+                math::xz_to_xyz(bounds.min, 0),
+                math::xz_to_xyz(bounds.max, Chunk::SIZE.y - 1))),
         [&](const Offset &offset) {
             if (overflow || (this->flags[offset] & flags) != flags) {
                 return;
@@ -301,8 +427,92 @@ std::array<Chunk*, 4> Chunk::neighbors() {
     return res;
 }
 
+void Chunk::update_heights(const ivec2 &tile) {
+    const auto i = Chunk::to_cell(tile);
+    this->heights[i] = 0;
+    this->heights_solid[i] = 0;
+
+    for (isize y = Chunk::SIZE.y - 1; y >= 0; y--) {
+        const auto pos = ivec3(tile.x, y, tile.y);
+        const TileId t = this->tiles[pos];
+
+        if (t == 0) {
+            continue;
+        }
+
+        if (this->heights[i] == 0) {
+            this->heights[i] = y + 1;
+        }
+
+        if (Tiles::get()[t].solid(*this->level, this->offset_tiles + pos)) {
+            this->heights_solid[i] = y + 1;
+            break;
+        }
+    }
+}
+
+void Chunk::summarize(const ivec3 &pos, Data old_data, Data new_data) {
+    const auto
+        old_air = Chunk::TileData::from(old_data) == 0,
+        new_air = Chunk::TileData::from(new_data) == 0;
+
+    if (old_air != new_air) {
+        this->summary.non_air[pos.y] += new_air ? -1 : 1;
+    }
+
+    const auto
+        old_flags = Chunk::FlagsData::from(old_data),
+        new_flags = Chunk::FlagsData::from(new_data);
+
+    if (old_flags != new_flags) {
+        for (usize i = 0; i < TF_COUNT; i++) {
+            const auto bit = FlagsType(1) << i;
+            this->summary.flags[i] +=
+                ((new_flags & bit) ? 1 : 0) - ((old_flags & bit) ? 1 : 0);
+        }
+
+        // track random tickable, light emitting and extras tiles
+        const auto index = static_cast<u16>(Offset(pos));
+        track(
+            this->tickable,
+            index,
+            old_flags & TF_RANDOM_TICK,
+            new_flags & TF_RANDOM_TICK);
+        track(
+            this->emitters,
+            index,
+            old_flags & TF_LIGHT,
+            new_flags & TF_LIGHT);
+        track(
+            this->extras,
+            index,
+            old_flags & TF_RENDER_EXTRAS,
+            new_flags & TF_RENDER_EXTRAS);
+    }
+}
+
 void Chunk::on_modify(
     DataType type, const ivec3 &pos, Data old_data, Data &new_data) {
+    this->summarize(pos, old_data, new_data);
+
+    // any write which changes tiles (DT_TILE, DT_RAW) can move the heightmap
+    if (Chunk::TileData::from(old_data) != Chunk::TileData::from(new_data)) {
+        const auto i = Chunk::to_cell(pos.xz());
+        const auto new_tile = Chunk::TileData::from(new_data);
+
+        if (new_tile != 0
+                && pos.y + 1 >= this->heights_solid[i]
+                && Tiles::get()[new_tile].solid(
+                    *this->level, this->offset_tiles + pos)) {
+            // new topmost solid tile, no need to rescan
+            this->heights_solid[i] = pos.y + 1;
+            this->heights[i] = math::max<u8>(this->heights[i], pos.y + 1);
+        } else if (pos.y + 1 >= this->heights_solid[i]) {
+            // tile at or above the solid height changed
+            this->update_heights(pos.xz());
+        }
+    }
+
     if (type == DT_TILE) {
         const auto
             old_tile = Chunk::TileData::from(old_data),
@@ -323,27 +533,43 @@ void Chunk::on_modify(
         if (new_tile != 0) {
             flags |= tile.can_emit_light() ? TF_LIGHT : 0;
             flags |= tile.renderer().has_extras() ? TF_RENDER_EXTRAS : 0;
+            flags |= tile.random_tickable() ? TF_RANDOM_TICK : 0;
         }
+        const Data before_flags = this->raw[pos];
         this->flags[pos] = flags;
+        this->summarize(pos, before_flags, this->raw[pos]);
 
         if (!same_tile) {
+            const auto pos_l = this->offset_tiles + pos;
+            const auto old_light = Chunk::LightData::from(old_data);
+            const auto was_emitter =
+                (Chunk::FlagsData::from(old_data) & TF_LIGHT) != 0;
             const auto transparent =
                 new_tile == 0
                     || tile.transparency_type() != Tile::Transparency::OFF;
 
-            if (transparent) {
-                Light::update(
-                    *this->level,
-                    this->offset_tiles + pos);
-            } else if (Chunk::LightData::from(old_data) != 0) {
-                // remove light if tile was replaced with solid
-                Light::remove(
-                    *this->level,
-                    this->offset_tiles + pos,
-                    Chunk::LightData::from(old_data));
+            if (old_light != 0 && (was_emitter || !transparent)) {
+                // remove light if tile was replaced with solid or was itself
+                // emitting, removal refills from neighboring light
+                Light::remove(*this->level, pos_l, old_light);
+            } else if (transparent) {
+                Light::update(*this->level, pos_l);
             }
 
-            // TODO: propagate if tile is light emitting
+            // propagate if new tile is light emitting, see LightEngine::bake
+            if (flags & TF_LIGHT) {
+                u8 value = 0;
+                for (const auto &l : tile.lights(*this->level, pos_l)) {
+                    value = math::max(value, l.value);
+                }
+
+                if (value != 0) {
+                    Light::add(
+                        *this->level,
+                        pos_l,
+                        math::min(value, LightEngine::MAX_VALUE));
+                }
+            }
         }
     }
 }
@@ -5,10 +5,12 @@
 #include "util/math.hpp"
 #include "util/resource.hpp"
 #include "util/direction.hpp"
+#include "util/palette_array.hpp"
 #include "serialize/annotations.hpp"
 #include "level/light.hpp"
 #include "tile/tile.hpp"
 #include "entity/util.hpp"
+#include "constants.hpp"
 
 struct Level;
 struct Entity;
@@ -19,6 +21,33 @@ struct Chunk {
     static constexpr ivec3 SIZE = ivec3(32, 8, 32);
     static constexpr usize VOLUME = SIZE.x * SIZE.y * SIZE.z;
 
+    // chunks are split into sections for dirty tracking (see dirty_sections),
+    // each of which is meshed, uploaded and culled independently by
+    // ChunkRenderer
+    static constexpr ivec3 SECTION_SIZE = ivec3(16, 8, 16);
+    static constexpr ivec3 SECTIONS =
+        ivec3(
+            SIZE.x / SECTION_SIZE.x,
+            SIZE.y / SECTION_SIZE.y,
+            SIZE.z / SECTION_SIZE.z);
+    static constexpr usize NUM_SECTIONS = SECTIONS.x * SECTIONS.y * SECTIONS.z;
+
+    // strides between data indices (see Offset) of adjacent positions
+    static constexpr isize
+        STRIDE_X = 1 << 8,
+        STRIDE_Y = 1 << 5,
+        STRIDE_Z = 1 << 0;
+
+    // bitmask of sections
+    using SectionMask = u32;
+    static_assert(NUM_SECTIONS <= sizeof(SectionMask) * 8);
+
+    static constexpr SectionMask ALL_SECTIONS =
+        static_cast<SectionMask>((u64(1) << NUM_SECTIONS) - 1);
+
+    // interval at which chunk data palettes are compacted
+    static constexpr usize COMPACT_INTERVAL_TICKS = 10 * TICKS_PER_SECOND;
+
     // compressed offset into chunk data (u16 sized)
     struct Offset {
         Offset(const ivec3 &pos) : Offset(pos.x, pos.y, pos.z) {
@@ -46,6 +75,13 @@ struct Chunk {
         explicit operator u16() const {
             return i;
         }
+
+        // reinterpret raw u16 as offset
+        static inline Offset from_raw(u16 i) {
+            Offset o(u16(0), u16(0), u16(0));
+            o.i = i;
+            return o;
+        }
 private:
     u16 i = 0;
     } PACKED;
@@ -57,9 +93,55 @@ private:
     enum TileFlags : FlagsType {
         TF_LIGHT = (1 << 0),            // if tile.can_emit_light()
         TF_RENDER_EXTRAS = (1 << 1),    // if tile.renderer().has_extras()
+        TF_RANDOM_TICK = (1 << 2),      // if tile.random_tickable()
         TF_COUNT = sizeof(FlagsType) * 8 // total number of possible flags
     };
 
+    // summary of chunk contents, maintained on modify so that scans over
+    // chunk data can skip empty chunks/layers
+    struct Summary {
+        // number of non-air tiles in each Y layer
+        std::array<u16, SIZE.y> non_air = {};
+
+        // number of tiles with each bit of TileFlags set
+        std::array<u16, TF_COUNT> flags = {};
+
+        // total number of non-air tiles
+        inline usize num_non_air() const {
+            usize n = 0;
+            for (const auto c : this->non_air) {
+                n += c;
+            }
+            return n;
+        }
+
+        // false if there are definitely no tiles with all of the specified
+        // flags
+        inline bool has_flags(FlagsType fs) const {
+            for (usize i = 0; i < TF_COUNT; i++) {
+                if ((fs & (FlagsType(1) << i)) && this->flags[i] == 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // clamp Y of (chunk-space) area to non-empty layers, result has
+        // min.y > max.y if all layers in area are empty
+        inline AABBi clamp(const AABBi &area) const {
+            auto res = area;
+            while (res.min.y <= res.max.y && this->non_air[res.min.y] == 0) {
+                res.min.y++;
+            }
+
+            while (res.max.y >= res.min.y && this->non_air[res.max.y] == 0) {
+                res.max.y--;
+            }
+
+            return res;
+        }
+    };
+
     // chunk data base type
     using Data = u64;
 
@@ -78,7 +160,8 @@ private:
         [DT_TILE] = DTF_ON_MODIFY | DTF_BUMP_RENDER,
         [DT_LIGHT] = DTF_NONE,
         [DT_SUBTILE] = DTF_ON_MODIFY | DTF_BUMP_RENDER,
-        [DT_GHOST] = DTF_BUMP_RENDER,
+        // ghosting is resolved at draw time, see ChunkRenderer::Pass
+        [DT_GHOST] = DTF_NONE,
         [DT_FLAGS] = DTF_ON_MODIFY | DTF_BUMP_RENDER,
     };
 
@@ -96,11 +179,13 @@ private:
             _D = D;
 
         // proxy for access to individual element
+        // NOTE: chunk data is paletted, so proxies refer to elements by index
+        // rather than by pointer
         struct Proxy {
             using ParentType = Type;
 
             ChunkDataAccess *parent = nullptr;
-            Data *data = nullptr;
+            u16 index = 0;
 
             Proxy() = default;
 
@@ -109,13 +194,16 @@ private:
 
             Proxy(ChunkDataAccess *parent, u16 i)
                 : parent(parent),
-                  data(&(parent->chunk->data[i])) { }
+                  index(i) { }
 
-            Proxy(ChunkDataAccess *parent, Data *data)
-                : parent(parent), data(data) { }
+            // full data word for this element
+            inline Data raw() const {
+                return this->parent->chunk->data.get(this->index);
+            }
 
-            inline Data *ptr() const {
-                return this->data;
+            // overwrite full data word for this element
+            inline void set_raw(Data d) const {
+                this->parent->chunk->data.set(this->index, d);
             }
 
             inline T get() const {
@@ -123,7 +211,7 @@ private:
             }
 
             inline operator T() const {
-                return static_cast<T>(((*this->data) & M) >> O);
+                return static_cast<T>((this->raw() & M) >> O);
             }
 
             inline Proxy &operator=(T value) {
@@ -140,20 +228,23 @@ private:
             ivec3 pos;
             Proxy p;
 
-            SafeProxy(ChunkDataAccess *parent, Data *data)
-                : p(parent, data) { }
+            SafeProxy() = default;
             SafeProxy(ChunkDataAccess *parent, const ivec3 &pos) {
                 this->pos = pos;
                 this->p = Chunk::in_bounds(pos) ?
-                    Proxy(parent, pos) : Proxy(nullptr, nullptr);
+                    Proxy(parent, pos) : Proxy();
+            }
+
+            inline Data raw() const {
+                return this->p.raw();
             }
 
-            inline Data *ptr() const {
-                return this->p.data;
+            inline void set_raw(Data d) const {
+                this->p.set_raw(d);
             }
 
             inline bool present() const {
-                return this->p.data;
+                return this->p.parent;
             }
 
             inline T get() const {
@@ -161,7 +252,7 @@ private:
             }
 
             inline operator T() const {
-                return this->p.data ? static_cast<T>(p) : 0;
+                return this->present() ? static_cast<T>(p) : 0;
             }
 
             inline SafeProxy &operator=(T value) {
@@ -172,7 +263,7 @@ private:
         };
 
         // proxy which evaluates to zero and crashes on assignment
-        static const inline auto ZERO = SafeProxy(nullptr, nullptr);
+        static const inline auto ZERO = SafeProxy();
 
         Chunk *chunk;
 
@@ -211,10 +302,6 @@ private:
             return SafeProxy(this, o);
         }
 
-        inline Proxy as_proxy(Data &d) {
-            return Proxy(this, &d);
-        }
-
         template <typename U>
         static inline T from(const U &d) {
             return static_cast<T>((static_cast<Data>(d) & M) >> O);
@@ -243,8 +330,9 @@ private:
             constexpr auto dt = U::ParentType::_D;
             constexpr auto dtf = DATA_TYPE_FLAGS[dt];
 
-            Data *p = d.ptr(), old = *p;
-            *p = ((*p) & ~M) | ((static_cast<Data>(v) << O) & M);
+            const Data old = d.raw();
+            Data data = (old & ~M) | ((static_cast<Data>(v) << O) & M);
+            d.set_raw(data);
 
             Chunk *c;
             if constexpr (!IS_SAFE) {
@@ -253,30 +341,39 @@ private:
                 c = d.p.parent->chunk;
 
                 if constexpr (dtf & DTF_ON_MODIFY) {
-                    d.p.parent->chunk->on_modify(dt, d.pos, old, *p);
+                    d.p.parent->chunk->on_modify(dt, d.pos, old, data);
                 }
             }
 
-            // bump version of this chunk
-            c->version++;
-
             constexpr auto bump_render =
                 !DO_NOT_MESH && (dtf & DTF_BUMP_RENDER);
 
+            // bump version of this chunk
+            c->bump(bump_render);
+
             if constexpr (bump_render) {
-                c->render_version++;
+                if constexpr (IS_SAFE) {
+                    c->mark_dirty(d.pos);
+                } else {
+                    const ivec3 pos = Offset::from_raw(d.index);
+                    c->mark_dirty(pos);
+                }
             }
 
             if constexpr (IS_SAFE) {
                 // bump neighboring versions if value changed
                 const auto border = Chunk::border(d.pos);
-                if (border && v != d.get()) {
+                if (border && old != data) {
                     auto *neighbor = c->neighbor(*border);
                     if (neighbor) {
-                        neighbor->version++;
+                        neighbor->bump(bump_render);
 
                         if constexpr (bump_render) {
-                            neighbor->render_version++;
+                            // adjacent tile in neighbor
+                            neighbor->mark_dirty(
+                                (d.pos
+                                    + Direction::to_ivec3(*border)
+                                    + Chunk::SIZE) % Chunk::SIZE);
                         }
                     }
                 }
@@ -284,7 +381,8 @@ private:
         }
     };
 
-    std::array<Chunk::Data, Chunk::VOLUME> data;
+    // paletted chunk data, see util/palette_array.hpp
+    PaletteArray<Chunk::Data, Chunk::VOLUME> data;
 
     [[SERIALIZE_BY_CTX(SERIALIZE_IGNORE, SerializationContextLevel::get_level)]]
     Level *level;
@@ -298,6 +396,53 @@ private:
     // version, but it only changes when the chunk could need to be remeshed
     u64 render_version;
 
+    // see Summary
+    [[SERIALIZE_IGNORE]]
+    Summary summary;
+
+    // (unordered) data indices of all tiles with TF_RANDOM_TICK, maintained
+    // by summarize(). usually small, so removal is a linear search.
+    [[SERIALIZE_IGNORE]]
+    std::vector<u16> tickable;
+
+    // (unordered) data indices of all tiles with TF_LIGHT, as above
+    [[SERIALIZE_IGNORE]]
+    std::vector<u16> emitters;
+
+    // (unordered) data indices of all tiles with TF_RENDER_EXTRAS, as above
+    [[SERIALIZE_IGNORE]]
+    std::vector<u16> extras;
+
+    // (unordered) entities in this chunk which can emit light (see
+    // Entity::can_emit_light), maintained by {add, remove}_entity
+    [[SERIALIZE_IGNORE]]
+    std::vector<Entity*> light_entities;
+
+    // sections which may need to be remeshed, consumed by ChunkRenderer
+    [[SERIALIZE_IGNORE]]
+    SectionMask dirty_sections = ALL_SECTIONS;
+
+    // true while this chunk's level is in an edit transaction, version bumps
+    // are deferred until it is committed (see Level::begin_edit)
+    [[SERIALIZE_IGNORE]]
+    bool in_edit = false;
+
+    // version bumps deferred by an edit transaction
+    [[SERIALIZE_IGNORE]]
+    bool pending_version = false;
+
+    [[SERIALIZE_IGNORE]]
+    bool pending_render_version = false;
+
+    // per-column heightmaps, maintained on modify (see Chunk::on_modify).
+    // each entry is one above the Y of the topmost non-air/solid tile in the
+    // column, or 0 if there is no such tile.
+    [[SERIALIZE_IGNORE]]
+    std::array<u8, Chunk::SIZE.x * Chunk::SIZE.z> heights = {};
+
+    [[SERIALIZE_IGNORE]]
+    std::array<u8, Chunk::SIZE.x * Chunk::SIZE.z> heights_solid = {};
+
     // data accessors
     // types are declared explicitly for easy use of their static methods
     using RawData =
@@ -326,13 +471,19 @@ private:
     [[SERIALIZE_IGNORE]] GhostData ghost;
     [[SERIALIZE_IGNORE]] FlagsData flags;
 
-    // tracked by entity, see entity.{hpp, cpp}
+    // all entities in chunk (unordered), tracked by entity, see
+    // entity.{hpp, cpp}. entities are swap-removed by Entity::chunk_index.
+    [[SERIALIZE_IGNORE]]
+    std::vector<Entity*> entities;
+
+    // spatial index of entities by XZ tile: each cell is the head of an
+    // intrusive doubly linked list through Entity::cell_{prev, next}
     [[SERIALIZE_IGNORE]]
-    std::unordered_set<Entity*> entities;
+    std::array<Entity*, Chunk::SIZE.x * Chunk::SIZE.z> cell_heads = {};
 
+    // number of entities in each cell of cell_heads
     [[SERIALIZE_IGNORE]]
-    std::array<std::unordered_set<Entity*>, Chunk::SIZE.x * Chunk::SIZE.z>
-        xz_entities;
+    std::array<u16, Chunk::SIZE.x * Chunk::SIZE.z> cell_counts = {};
 
     Chunk(Level &level, ivec2 offset);
 
@@ -364,32 +515,47 @@ private:
         return this->raw[p];
     }
 
-    inline auto &get_xz_entities(const ivec2 &tile) {
+    // index of XZ tile in cell_heads/cell_counts
+    static inline usize to_cell(const ivec2 &tile) {
         ASSERT(tile.x >= 0 && tile.y >= 0
                && tile.x < Chunk::SIZE.x && tile.y < Chunk::SIZE.z);
-        return this->xz_entities[tile.x * Chunk::SIZE.z + tile.y];
+        return tile.x * Chunk::SIZE.z + tile.y;
     }
 
-    inline auto &get_xz_entities(const ivec2 &tile) const {
-        ASSERT(tile.x >= 0 && tile.y >= 0
-               && tile.x < Chunk::SIZE.x && tile.y < Chunk::SIZE.z);
-        return this->xz_entities[tile.x * Chunk::SIZE.z + tile.y];
+    // height of column at (chunk-space) XZ tile, see heights
+    inline usize height(const ivec2 &tile) const {
+        return this->heights[Chunk::to_cell(tile)];
     }
 
+    // solid height of column at (chunk-space) XZ tile, see heights_solid
+    inline usize height_solid(const ivec2 &tile) const {
+        return this->heights_solid[Chunk::to_cell(tile)];
+    }
+
+    // true if every position in the chunk holds the same data
+    inline bool uniform() const {
+        return this->data.uniform();
+    }
+
+    // update summary for the change of data at pos from old_data to new_data
+    void summarize(const ivec3 &pos, Data old_data, Data new_data);
+
+    // recompute heightmaps for column at (chunk-space) XZ tile
+    void update_heights(const ivec2 &tile);
+
+    // add entity to this chunk on the specified (chunk-space) XZ tile
+    void add_entity(Entity &e, const ivec2 &tile);
+
+    // remove entity from this chunk, tile must be the one it was added on
+    void remove_entity(Entity &e, const ivec2 &tile);
+
+    // move entity within this chunk between (chunk-space) XZ tiles
+    void move_entity(Entity &e, const ivec2 &from, const ivec2 &to);
+
     // number of entities on a tile
-    inline usize num_entities(
+    usize num_entities(
         const ivec2 &tile,
-        std::optional<EntityFilterFn> filter = std::nullopt) const {
-        if (!filter) {
-            return this->get_xz_entities(tile).size();
-        } else {
-            const auto &xze = this->get_xz_entities(tile);
-            return std::count_if(
-                xze.begin(),
-                xze.end(),
-                [&](Entity *e) { return (*filter)(*e); });
-        }
-    }
+        std::optional<EntityFilterFn> filter = std::nullopt) const;
 
     // retrieve entities on a tile
     std::tuple<usize, bool> get_entities(
@@ -431,6 +597,69 @@ private:
     // array entry is nullptr if not present
     std::array<Chunk*, 4> neighbors();
 
+    // bump version (and render_version if render is true), deferring until
+    // the end of the current edit transaction if there is one
+    inline void bump(bool render) {
+        if (this->in_edit) {
+            this->pending_version = true;
+            this->pending_render_version |= render;
+            return;
+        }
+
+        this->version++;
+
+        if (render) {
+            this->render_version++;
+        }
+    }
+
+    // section index of (chunk-space) position
+    static inline usize to_section(const ivec3 &pos) {
+        const auto p = pos / Chunk::SECTION_SIZE;
+        return (p.x * Chunk::SECTIONS.y * Chunk::SECTIONS.z)
+            + (p.y * Chunk::SECTIONS.z)
+            + p.z;
+    }
+
+    // mark section containing (chunk-space) pos as dirty, along with any
+    // sections it borders within this chunk as their geometry can depend on
+    // neighboring tiles
+    inline void mark_dirty(const ivec3 &pos) {
+        SectionMask mask = SectionMask(1) << Chunk::to_section(pos);
+
+        for (usize i = 0; i < 3; i++) {
+            const auto r = pos[i] % Chunk::SECTION_SIZE[i];
+
+            if (r == 0 && pos[i] != 0) {
+                auto p = pos;
+                p[i]--;
+                mask |= SectionMask(1) << Chunk::to_section(p);
+            } else if (
+                r == Chunk::SECTION_SIZE[i] - 1
+                    && pos[i] != Chunk::SIZE[i] - 1) {
+                auto p = pos;
+                p[i]++;
+                mask |= SectionMask(1) << Chunk::to_section(p);
+            }
+        }
+
+        this->dirty_sections |= mask;
+    }
+
+    // apply version bumps deferred by an edit transaction
+    inline void flush_bumps() {
+        if (this->pending_version) {
+            this->version++;
+        }
+
+        if (this->pending_render_version) {
+            this->render_version++;
+        }
+
+        this->pending_version = false;
+        this->pending_render_version = false;
+    }
+
     // called whenever chunk is modified via safe proxy AND DataType flag
     // DTF_ON_MODIFY is specified for "type"
     void on_modify(
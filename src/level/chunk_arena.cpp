@@ -0,0 +1,55 @@
+#include "level/chunk_arena.hpp"
+
+template <typename T, typename H>
+void ChunkArena::Pool<T, H>::create() {
+    this->buffer_capacity = this->allocator.capacity();
+
+    if constexpr (std::is_same_v<H, bgfx::DynamicIndexBufferHandle>) {
+        static_assert(std::is_same_v<T, u32>);
+        this->buffer =
+            gfx::as_bgfx_resource(
+                bgfx::createDynamicIndexBuffer(
+                    this->buffer_capacity,
+                    BGFX_BUFFER_INDEX32));
+    } else {
+        this->buffer =
+            gfx::as_bgfx_resource(
+                bgfx::createDynamicVertexBuffer(
+                    this->buffer_capacity,
+                    T::layout));
+    }
+}
+
+template <typename T, typename H>
+void ChunkArena::Pool<T, H>::write(
+    const Range &range,
+    std::span<const T> src) {
+    ASSERT(src.size() == range.size);
+
+    if (range.empty()) {
+        return;
+    }
+
+    if (this->buffer_capacity != this->allocator.capacity()) {
+        // grown (or first write), re-create. every other range must be
+        // re-written by its owner before the buffer is next drawn from.
+        this->create();
+        this->generation++;
+    }
+
+    bgfx::update(
+        this->buffer, range.offset,
+        bgfx::copy(&src[0], src.size() * sizeof(T)));
+}
+
+template struct ChunkArena::Pool<
+    ChunkVertex, bgfx::DynamicVertexBufferHandle>;
+template struct ChunkArena::Pool<
+    ChunkVertexPacked, bgfx::DynamicVertexBufferHandle>;
+template struct ChunkArena::Pool<
+    u32, bgfx::DynamicIndexBufferHandle>;
+
+ChunkArena::ChunkArena()
+    : vertices(INITIAL_VERTICES),
+      packed_vertices(INITIAL_PACKED_VERTICES),
+      indices(INITIAL_INDICES) {}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "util/types.hpp"
+#include "util/util.hpp"
+#include "util/resource.hpp"
+#include "util/range_allocator.hpp"
+#include "gfx/bgfx.hpp"
+#include "gfx/util.hpp"
+#include "level/chunk_renderer.hpp"
+
+// level-wide GPU geometry for chunk meshes: one vertex buffer per chunk
+// vertex format and a single (32 bit) index buffer, sub-allocated by
+// RangeAllocator. chunk renderers own ranges rather than buffers so that
+// remeshing never creates or destroys GPU buffers and any contiguous run of
+// indices can be drawn in one submission (see ChunkRenderer::render).
+//
+// indices are absolute into the vertex buffers, draws always use a base
+// vertex of zero.
+//
+// no CPU copy of the geometry is kept. a pool which grows is re-created
+// empty, and chunk renderers re-upload from their own (CPU-side) sections
+// once they see generation() change (see ChunkRenderer::restore).
+struct ChunkArena {
+    using Range = RangeAllocator::Range;
+
+    // initial capacities, in elements. pools grow by doubling.
+    static constexpr usize
+        INITIAL_VERTICES = 64 * 1024,
+        INITIAL_PACKED_VERTICES = 256 * 1024,
+        INITIAL_INDICES = 512 * 1024;
+
+    // a single growable GPU buffer of T with handle type H
+    template <typename T, typename H>
+    struct Pool {
+        RangeAllocator allocator;
+
+        RDResource<H> buffer;
+
+        // capacity of buffer, may lag allocator.capacity() until next write
+        usize buffer_capacity = 0;
+
+        // number of times buffer has been (re-)created. bgfx does not resize
+        // dynamic buffers which are updated at an offset, so on growth the
+        // buffer is re-created without the contents of any other range.
+        usize generation = 0;
+
+        Pool() = default;
+        explicit Pool(usize capacity)
+            : allocator(capacity) {}
+
+        inline Range alloc(usize n) {
+            return this->allocator.alloc(n);
+        }
+
+        inline void free(const Range &range) {
+            this->allocator.free(range);
+        }
+
+        // writes src to range, which must be allocated from this pool
+        void write(const Range &range, std::span<const T> src);
+
+    private:
+        void create();
+    };
+
+    Pool<ChunkVertex, bgfx::DynamicVertexBufferHandle> vertices;
+    Pool<ChunkVertexPacked, bgfx::DynamicVertexBufferHandle> packed_vertices;
+    Pool<u32, bgfx::DynamicIndexBufferHandle> indices;
+
+    ChunkArena();
+    ChunkArena(const ChunkArena &other) = delete;
+    ChunkArena(ChunkArena &&other) = delete;
+    ChunkArena &operator=(const ChunkArena &other) = delete;
+    ChunkArena &operator=(ChunkArena &&other) = delete;
+
+    // changes whenever any pool loses its contents
+    inline usize generation() const {
+        return this->vertices.generation
+            + this->packed_vertices.generation
+            + this->indices.generation;
+    }
+};
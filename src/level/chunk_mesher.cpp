@@ -0,0 +1,137 @@
+#include "level/chunk_mesher.hpp"
+
+// pops from a free list, nullptr if it is empty
+template <typename T>
+static std::unique_ptr<T> take(std::vector<std::unique_ptr<T>> &free) {
+    if (free.empty()) {
+        return nullptr;
+    }
+
+    auto p = std::move(free.back());
+    free.pop_back();
+    return p;
+}
+
+ChunkMesher::ChunkMesher(usize threads) {
+    if (threads == 0) {
+        const usize n = std::thread::hardware_concurrency();
+        threads = n > 1 ? (n - 1) : 1;
+    }
+
+    for (usize i = 0; i < threads; i++) {
+        this->threads.emplace_back([this]() { this->work(); });
+    }
+}
+
+ChunkMesher::~ChunkMesher() {
+    {
+        std::lock_guard lock(this->mutex);
+        this->stop = true;
+    }
+
+    this->cv.notify_all();
+
+    for (auto &t : this->threads) {
+        t.join();
+    }
+}
+
+void ChunkMesher::submit(
+    ChunkRenderer &renderer,
+    Chunk::SectionMask sections) {
+    auto &chunk = renderer.chunk;
+
+    std::unique_ptr<Result> result;
+    std::unique_ptr<ChunkNeighborhood> neighborhood;
+    {
+        std::lock_guard lock(this->mutex);
+        result = take(this->free_results);
+        neighborhood = take(this->free_neighborhoods);
+    }
+
+    if (result) {
+        for (auto &section : result->sections) {
+            section.clear();
+        }
+    } else {
+        result = std::make_unique<Result>();
+    }
+
+    if (neighborhood) {
+        neighborhood->build(chunk);
+    } else {
+        neighborhood = std::make_unique<ChunkNeighborhood>(chunk);
+    }
+
+    result->id = renderer.id;
+    result->offset = chunk.offset;
+    result->version = chunk.render_version;
+    result->mask = sections;
+
+    // custom tiles read the level, mesh them now
+    ChunkRenderer::mesh_custom(chunk, sections, result->sections);
+
+    auto job = Job {
+        std::move(neighborhood),
+        std::move(result)
+    };
+
+    renderer.pending_version = chunk.render_version;
+    chunk.dirty_sections = 0;
+
+    {
+        std::lock_guard lock(this->mutex);
+        this->queue.push_back(std::move(job));
+    }
+
+    this->cv.notify_one();
+}
+
+void ChunkMesher::cancel(u64 id) {
+    std::lock_guard lock(this->mutex);
+    std::erase_if(
+        this->queue,
+        [&](const Job &job) { return job.result->id == id; });
+}
+
+usize ChunkMesher::pending() const {
+    std::lock_guard lock(this->mutex);
+    return this->queue.size() + this->running;
+}
+
+void ChunkMesher::work() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock(this->mutex);
+            this->cv.wait(
+                lock,
+                [this]() { return this->stop || !this->queue.empty(); });
+
+            if (this->stop) {
+                return;
+            }
+
+            job = std::move(this->queue.front());
+            this->queue.pop_front();
+            this->running++;
+        }
+
+        ChunkRenderer::mesh_default(
+            *job.neighborhood, job.result->mask, job.result->sections);
+
+        {
+            std::lock_guard lock(this->mutex);
+            this->done.push_back(std::move(job.result));
+            this->running--;
+
+            if (this->free_neighborhoods.size() < MAX_FREE) {
+                this->free_neighborhoods.push_back(
+                    std::move(job.neighborhood));
+            }
+        }
+
+        // neighborhood is large, free it off of the lock if not reused
+        job.neighborhood.reset();
+    }
+}
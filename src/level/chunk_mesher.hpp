@@ -0,0 +1,101 @@
+#pragma once
+
+#include <memory>
+#include <condition_variable>
+
+#include "util/types.hpp"
+#include "util/util.hpp"
+#include "util/math.hpp"
+#include "level/chunk_renderer.hpp"
+
+// meshes chunks on worker threads.
+//
+// submit() does everything which must happen on the main thread (snapshotting
+// chunk data, meshing custom tiles) and queues the rest. finished meshes are
+// collected with poll() on the render thread, which is the only place that
+// GPU buffers are touched. a chunk renderer keeps drawing its old mesh until
+// the new one is applied, so chunk edits never stall a frame on meshing.
+struct ChunkMesher {
+    // default number of worker threads, 0 for one less than the hardware
+    // concurrency
+    static constexpr usize DEFAULT_THREADS = 0;
+
+    // finished mesh for the sections in mask of a chunk at version
+    struct Result {
+        u64 id;
+        ivec2 offset;
+        usize version;
+        Chunk::SectionMask mask;
+        std::array<ChunkRenderer::Section, Chunk::NUM_SECTIONS> sections;
+    };
+
+    explicit ChunkMesher(usize threads = DEFAULT_THREADS);
+    ~ChunkMesher();
+
+    ChunkMesher(const ChunkMesher &other) = delete;
+    ChunkMesher(ChunkMesher &&other) = delete;
+    ChunkMesher &operator=(const ChunkMesher &other) = delete;
+    ChunkMesher &operator=(ChunkMesher &&other) = delete;
+
+    // queues remesh of sections of chunk renderer, marks the renderer as
+    // pending until the result is polled
+    void submit(ChunkRenderer &renderer, Chunk::SectionMask sections);
+
+    // calls f on each finished result, on the calling thread
+    template <typename F>
+    void poll(F &&f) {
+        std::vector<std::unique_ptr<Result>> done;
+        {
+            std::lock_guard lock(this->mutex);
+            std::swap(done, this->done);
+        }
+
+        for (auto &r : done) {
+            f(*r);
+        }
+
+        // keep results (and so their buffers) around for submit()
+        std::lock_guard lock(this->mutex);
+        for (auto &r : done) {
+            if (this->free_results.size() >= MAX_FREE) {
+                break;
+            }
+
+            this->free_results.push_back(std::move(r));
+        }
+    }
+
+    // drops queued work for chunk renderer with id, if it has not started
+    void cancel(u64 id);
+
+    // number of jobs which are queued or running
+    usize pending() const;
+
+private:
+    // maximum number of each kind of storage kept for reuse
+    static constexpr usize MAX_FREE = 32;
+
+    struct Job {
+        std::unique_ptr<ChunkNeighborhood> neighborhood;
+        std::unique_ptr<Result> result;
+    };
+
+    void work();
+
+    std::vector<std::thread> threads;
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    bool stop = false;
+
+    // number of jobs currently being meshed
+    usize running = 0;
+
+    std::deque<Job> queue;
+    std::vector<std::unique_ptr<Result>> done;
+
+    // polled results and finished neighborhoods, reused by submit() so that
+    // meshing stops allocating once their buffers have grown
+    std::vector<std::unique_ptr<Result>> free_results;
+    std::vector<std::unique_ptr<ChunkNeighborhood>> free_neighborhoods;
+};
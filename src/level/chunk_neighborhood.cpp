@@ -0,0 +1,89 @@
+#include "level/chunk_neighborhood.hpp"
+#include "level/level.hpp"
+
+// position in neighbor of a border coordinate in [-1, size]
+static inline isize wrap(isize i, isize size) {
+    return i < 0 ? (size - 1) : i >= size ? 0 : i;
+}
+
+void ChunkNeighborhood::build(const Chunk &chunk) {
+    this->offset = chunk.offset;
+    this->offset_tiles = chunk.offset_tiles;
+    this->summary = chunk.summary;
+
+    // borders default to air, most of this is overwritten below
+    this->data.resize(VOLUME);
+    std::fill(this->data.begin(), this->data.end(), EMPTY);
+
+    // unpack once and copy contiguous z rows across. Chunk::Offset and
+    // index() share (x, y, z) major order so rows are a straight memcpy.
+    thread_local std::vector<Chunk::Data> unpacked;
+    unpacked.resize(Chunk::VOLUME);
+    chunk.data.unpack(unpacked);
+
+    for (isize x = 0; x < Chunk::SIZE.x; x++) {
+        for (isize y = 0; y < Chunk::SIZE.y; y++) {
+            std::memcpy(
+                &this->data[index(ivec3(x, y, 0))],
+                &unpacked[static_cast<u16>(Chunk::Offset(ivec3(x, y, 0)))],
+                Chunk::SIZE.z * sizeof(Chunk::Data));
+        }
+    }
+
+    if (!chunk.level) {
+        return;
+    }
+
+    // copy the border from each of the eight horizontal neighbors. on each
+    // axis a neighbor contributes a single layer (from its opposite side) or,
+    // if it is not offset on that axis, the whole range.
+    for (isize dx = -1; dx <= 1; dx++) {
+        for (isize dz = -1; dz <= 1; dz++) {
+            if (dx == 0 && dz == 0) {
+                continue;
+            }
+
+            const auto *neighbor =
+                chunk.level->chunkp(chunk.offset + ivec2(dx, dz));
+            if (!neighbor) {
+                continue;
+            }
+
+            const auto
+                x_min = dx < 0 ? -1 : dx > 0 ? Chunk::SIZE.x : 0,
+                x_max = dx == 0 ? Chunk::SIZE.x - 1 : x_min,
+                z_min = dz < 0 ? -1 : dz > 0 ? Chunk::SIZE.z : 0,
+                z_max = dz == 0 ? Chunk::SIZE.z - 1 : z_min;
+
+            const auto &src = neighbor->data;
+
+            // all of a uniform neighbor is its single value
+            if (src.uniform()) {
+                const auto value = src.get(0);
+                for (isize x = x_min; x <= x_max; x++) {
+                    for (isize y = 0; y < Chunk::SIZE.y; y++) {
+                        std::fill(
+                            &this->data[index(ivec3(x, y, z_min))],
+                            &this->data[index(ivec3(x, y, z_max))] + 1,
+                            value);
+                    }
+                }
+                continue;
+            }
+
+            for (isize x = x_min; x <= x_max; x++) {
+                const auto x_n = wrap(x, Chunk::SIZE.x);
+                for (isize y = 0; y < Chunk::SIZE.y; y++) {
+                    auto *dst = &this->data[index(ivec3(x, y, z_min))];
+                    for (isize z = z_min; z <= z_max; z++) {
+                        const auto z_n = wrap(z, Chunk::SIZE.z);
+                        *dst++ =
+                            src.get(
+                                static_cast<u16>(
+                                    Chunk::Offset(ivec3(x_n, y, z_n))));
+                    }
+                }
+            }
+        }
+    }
+}
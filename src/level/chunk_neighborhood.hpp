@@ -0,0 +1,86 @@
+#pragma once
+
+#include "util/types.hpp"
+#include "util/util.hpp"
+#include "util/math.hpp"
+#include "level/chunk.hpp"
+
+// padded copy of the raw data of a chunk along with a one tile border from
+// each of its (up to eight) horizontal neighbors. positions are chunk-space,
+// so valid positions range from -1 to Chunk::SIZE (inclusive) on each axis.
+// the border above and below the level, along with the border of missing
+// neighbors, is air.
+//
+// a neighborhood does not reference its chunk or level after being built, so
+// meshing, lighting and path queries can run on it on other threads while the
+// live chunks continue to change. every position (and its neighbor in any
+// direction) is a single index without bounds checks or chunk lookups.
+struct ChunkNeighborhood {
+    static constexpr ivec3 PADDING = ivec3(1);
+    static constexpr ivec3 SIZE =
+        ivec3(
+            Chunk::SIZE.x + (2 * PADDING.x),
+            Chunk::SIZE.y + (2 * PADDING.y),
+            Chunk::SIZE.z + (2 * PADDING.z));
+    static constexpr usize VOLUME = SIZE.x * SIZE.y * SIZE.z;
+
+    // strides between indices of adjacent positions, in the same (x, y, z)
+    // major order as Chunk::Offset so that z rows are contiguous in both
+    static constexpr isize
+        STRIDE_X = SIZE.y * SIZE.z,
+        STRIDE_Y = SIZE.z,
+        STRIDE_Z = 1;
+
+    // value of positions outside of the level or in unloaded neighbors
+    static constexpr Chunk::Data EMPTY = 0;
+
+    ivec2 offset;
+    ivec3 offset_tiles;
+    Chunk::Summary summary;
+
+    // padded data, indexed by index()
+    std::vector<Chunk::Data> data;
+
+    ChunkNeighborhood() = default;
+
+    explicit ChunkNeighborhood(const Chunk &chunk) {
+        this->build(chunk);
+    }
+
+    // (re)builds from chunk and its neighbors, reusing storage
+    void build(const Chunk &chunk);
+
+    // true if chunk-space pos is in this neighborhood (including the border)
+    static inline bool in_bounds(const ivec3 &pos) {
+        return pos.x >= -PADDING.x && pos.x < Chunk::SIZE.x + PADDING.x
+            && pos.y >= -PADDING.y && pos.y < Chunk::SIZE.y + PADDING.y
+            && pos.z >= -PADDING.z && pos.z < Chunk::SIZE.z + PADDING.z;
+    }
+
+    // index of chunk-space pos
+    static inline usize index(const ivec3 &pos) {
+        return ((pos.x + PADDING.x) * STRIDE_X)
+            + ((pos.y + PADDING.y) * STRIDE_Y)
+            + ((pos.z + PADDING.z) * STRIDE_Z);
+    }
+
+    // stride between the indices of a position and its neighbor in d
+    static inline isize stride(Direction::Enum d) {
+        const auto v = Direction::to_ivec3(d);
+        return (v.x * STRIDE_X) + (v.y * STRIDE_Y) + (v.z * STRIDE_Z);
+    }
+
+    inline Chunk::Data operator[](const ivec3 &pos) const {
+        ASSERT(in_bounds(pos));
+        return this->data[index(pos)];
+    }
+
+    inline Chunk::Data operator[](usize i) const {
+        return this->data[i];
+    }
+
+    // data of chunk-space pos, EMPTY if out of bounds
+    inline Chunk::Data get(const ivec3 &pos) const {
+        return in_bounds(pos) ? this->data[index(pos)] : EMPTY;
+    }
+};
@@ -1,6 +1,7 @@
 #include "level/chunk_renderer.hpp"
 #include "level/chunk.hpp"
 #include "level/level.hpp"
+#include "level/chunk_arena.hpp"
 #include "tile/tile_renderer.hpp"
 #include "tile/tile_renderer_basic.hpp"
 #include "gfx/cube.hpp"
@@ -8,6 +9,9 @@
 #include "gfx/renderer.hpp"
 #include "gfx/mesh_buffer.hpp"
 #include "gfx/render_context.hpp"
+#include "gfx/renderer_resource.hpp"
+#include "state/state_game.hpp"
+#include "occlusion_map.hpp"
 #include "constants.hpp"
 #include "global.hpp"
 
@@ -22,27 +26,130 @@ DECL_VERTEX_TYPE(ChunkVertex) {
         .end();
 }
 
+DECL_VERTEX_TYPE(ChunkVertexPacked) {
+    ChunkVertexPacked::layout
+        .begin()
+        .add(bgfx::Attrib::Color1, 4, bgfx::AttribType::Uint8, false, true)
+        .add(bgfx::Attrib::Color2, 4, bgfx::AttribType::Uint8, false, true)
+        .end();
+}
+
+// maximum number of unique face textures for packed vertices
+static constexpr usize MAX_FACES = 64 * 1024;
+
+// table of (st, st_specular) face textures indexed by packed vertices. only
+// ever grows, entries are uploaded lazily by upload_faces().
+static struct {
+    std::mutex mutex;
+    std::unordered_map<vec4, u16> indices;
+    std::vector<vec4> entries;
+    usize uploaded = 0;
+} face_table;
+
+using FaceBufferType = RDResource<bgfx::DynamicIndexBufferHandle>;
+static auto face_buffer =
+    RendererResource<FaceBufferType>(
+        []() {
+            return gfx::as_bgfx_resource(
+                bgfx::createDynamicIndexBuffer(
+                    (MAX_FACES * sizeof(vec4)) / sizeof(u16),
+                    BGFX_BUFFER_COMPUTE_READ));
+        });
+
+// uploads any face textures which have been added since the last upload
+static void upload_faces() {
+    std::lock_guard lock(face_table.mutex);
+    if (face_table.uploaded == face_table.entries.size()) {
+        return;
+    }
+
+    const auto n = face_table.entries.size() - face_table.uploaded;
+    bgfx::update(
+        face_buffer.get(),
+        (face_table.uploaded * sizeof(vec4)) / sizeof(u16),
+        bgfx::copy(
+            &face_table.entries[face_table.uploaded], n * sizeof(vec4)));
+    face_table.uploaded = face_table.entries.size();
+}
+
+u16 ChunkRenderer::face_index(const vec2 &st, const vec2 &st_specular) {
+    const auto key = vec4(st, st_specular);
+
+    // face table only ever grows, so indices seen by this thread are always
+    // valid and the shared table is only locked on a miss
+    static thread_local std::unordered_map<vec4, u16> cache;
+    if (const auto it = cache.find(key); it != cache.end()) {
+        return it->second;
+    }
+
+    std::lock_guard lock(face_table.mutex);
+    auto it = face_table.indices.find(key);
+    if (it == face_table.indices.end()) {
+        ASSERT(
+            face_table.entries.size() < MAX_FACES,
+            "too many chunk face textures");
+        const auto i = static_cast<u16>(face_table.entries.size());
+        face_table.entries.push_back(key);
+        it = face_table.indices.emplace(key, i).first;
+    }
+
+    cache[key] = it->second;
+    return it->second;
+}
+
+// in-plane axes of each face direction along which its texture's u and v
+// coordinates run
+static const auto FACE_AXES =
+    []() {
+        std::array<uvec2, Direction::COUNT> result;
+        for (const auto &d : Direction::ALL) {
+            const auto vertex =
+                [&](usize i) {
+                    return cube::VERTICES[
+                        cube::INDICES[
+                            (usize(d) * 6) + cube::UNIQUE_INDICES[i]]];
+                };
+
+            // first vertex is at (0, 0), third is at (1, 0) in tex coords
+            for (usize a = 0; a < 3; a++) {
+                if (a == Direction::axis(d)) {
+                    continue;
+                } else if (vertex(0)[a] != vertex(2)[a]) {
+                    result[d].x = a;
+                } else {
+                    result[d].y = a;
+                }
+            }
+        }
+        return result;
+    }();
+
+// emits a face of size (in tiles) "size" along FACE_AXES[direction] with
+// position (tile space) as its minimum corner
 static void emit_face(
-    ChunkRenderer &renderer,
     MeshBuffer<ChunkVertex, u32> &buffer,
     TileId id,
     ivec3 pos_c,
     vec3 position,
     TextureArea area_tex,
     TextureArea area_specular,
-    Direction::Enum direction) {
+    Direction::Enum direction,
+    const uvec2 &size = uvec2(1)) {
     // index offset
     const usize offset = buffer.num_vertices();
+    const auto axes = FACE_AXES[direction];
 
     // emit vertices
     usize i_v = buffer.vertices.size();
     buffer.vertices.resize(buffer.vertices.size() + 4);
     for (usize i = 0; i < 4; i++) {
         ChunkVertex cv;
-        const auto d =
+        auto d =
             cube::VERTICES[
                 cube::INDICES[
                     (direction * 6) + cube::UNIQUE_INDICES[i]]];
+        d[axes.x] *= size.x;
+        d[axes.y] *= size.y;
         cv.pos = position + d;
         cv.normal = cube::NORMALS[direction];
         cv.st =
@@ -51,7 +158,9 @@ static void emit_face(
         cv.st_specular =
             (cube::TEX_COORDS[i] * area_specular.sprite_unit)
                 + area_specular.min;
-        cv.tile_id = id;
+        cv.tile_id =
+            ChunkVertex::pack_tile_id(
+                id, uvec2(cube::TEX_COORDS[i]), size);
         buffer.vertices[i_v++] = cv;
     }
 
@@ -63,245 +172,851 @@ static void emit_face(
     }
 }
 
-static inline void emit_tile(
-    ChunkRenderer &renderer,
-    std::array<
-        MeshBuffer<ChunkVertex, u32>,
-        ChunkRenderer::PASS_COUNT> &buffers,
-    const ivec3 &pos) {
+// emit_face() for packed vertices, face texture is always one tile_unit()
+// and repeated size times
+static void emit_face_packed(
+    MeshBuffer<ChunkVertexPacked, u32> &buffer,
+    const ivec3 &pos_c,
+    u16 face,
+    Direction::Enum direction,
+    const uvec2 &size = uvec2(1)) {
+    const usize offset = buffer.num_vertices();
+    const auto axes = FACE_AXES[direction];
 
-    auto &chunk = renderer.chunk;
-    const auto data = chunk[pos];
+    usize i_v = buffer.vertices.size();
+    buffer.vertices.resize(buffer.vertices.size() + 4);
+    for (usize i = 0; i < 4; i++) {
+        auto d =
+            ivec3(
+                cube::VERTICES[
+                    cube::INDICES[
+                        (direction * 6) + cube::UNIQUE_INDICES[i]]]);
+        d[axes.x] *= size.x;
+        d[axes.y] *= size.y;
+        buffer.vertices[i_v++] =
+            ChunkVertexPacked(
+                pos_c + d,
+                direction,
+                uvec2(cube::TEX_COORDS[i]),
+                face,
+                size);
+    }
+
+    usize i_i = buffer.indices.size();
+    buffer.indices.resize(buffer.indices.size() + cube::FACE_INDICES.size());
+    for (usize i : cube::FACE_INDICES) {
+        buffer.indices[i_i++] = offset + i;
+    }
+}
+
+// true if face of tile t at pos in direction d is visible. ghost tiles are
+// not considered, faces hidden by them are instead emitted into
+// PASS_EXPOSED and revealed at draw time.
+static inline bool face_visible(
+    const ChunkNeighborhood &neighborhood,
+    const Tile &t,
+    const ivec3 &pos,
+    Direction::Enum d) {
+    // missing neighbors and the border above/below the level are air
+    const auto data_n = neighborhood[pos + Direction::to_ivec3(d)];
+    const auto &t_n = Tiles::get()[Chunk::TileData::from(data_n)];
+    if (t_n.id == 0) {
+        return true;
+    }
+
+    Tile::Transparency tt;
+    if ((tt = t_n.transparency_type()) != Tile::Transparency::OFF) {
+        return !(tt == Tile::Transparency::MERGED && (t_n.id == t.id));
+    } else if (t.subtile()) {
+        // only skip if full subtile
+        return Chunk::SubtileData::from(data_n) != 0xFF;
+    }
 
-    const auto pos_w = pos + chunk.offset_tiles;
+    // neither transparent nor partial subtile, do not show
+    return false;
+}
+
+// face which can be greedily merged with identical neighboring faces, id is 0
+// if there is no face
+struct MergeFace {
+    TileId id = 0;
+    ChunkRenderer::Pass pass = ChunkRenderer::PASS_DEFAULT;
+    vec2 st, st_specular;
+
+    inline bool operator==(const MergeFace &other) const {
+        return this->id == other.id
+            && this->pass == other.pass
+            && this->st == other.st
+            && this->st_specular == other.st_specular;
+    }
+};
+
+// emits default-rendered tile at pos. if faces is not nullptr, faces which
+// can be merged are written into it (indexed by direction) instead of being
+// emitted.
+// NOTE: tile renderers are given no level, as is done for icons
+static inline void emit_tile(
+    const ChunkNeighborhood &neighborhood,
+    ChunkRenderer::Section &section,
+    const ivec3 &pos,
+    std::array<MergeFace*, Direction::COUNT> *faces = nullptr) {
+    const auto data = neighborhood[pos];
+
+    const auto pos_w = pos + neighborhood.offset_tiles;
     const auto &t = Tiles::get()[Chunk::TileData::from(data)];
 
-    const auto &tile_renderer = t.renderer();
-    auto *buffer = &buffers[ChunkRenderer::PASS_DEFAULT];
+    // TODO: consider a dynamic_cast here to catch bad things?
+    const auto &renderer_basic =
+        static_cast<const TileRendererBasic&>(t.renderer());
 
-    if (!tile_renderer.is_default()) {
-        buffer = &buffers[tile_renderer.pass()];
+    const auto unit = ChunkRenderer::tile_unit();
 
-        if (tile_renderer.custom()) {
-            tile_renderer.mesh(
-                chunk.level,
+    for (const auto &d : Direction::ALL) {
+        // hidden faces are still needed if their neighbor can be ghosted
+        const auto visible = face_visible(neighborhood, t, pos, d);
+        const auto pass =
+            visible ?
+                ChunkRenderer::PASS_DEFAULT
+                : ChunkRenderer::PASS_EXPOSED;
+
+        const auto
+            area_tex = renderer_basic.coords(nullptr, pos_w, d),
+            area_specular =
+                renderer_basic.coords_specular(nullptr, pos_w, d);
+
+        const auto repeatable =
+            area_tex.sprite_unit == unit
+                && area_specular.sprite_unit == unit;
+
+        // defer to merging if textures can be repeated
+        if (faces && repeatable) {
+            *(*faces)[d] =
+                MergeFace {
+                    t.id,
+                    pass,
+                    area_tex.min,
+                    area_specular.min
+                };
+            continue;
+        } else if (repeatable
+                    && ChunkRenderer::format
+                        == ChunkRenderer::FORMAT_PACKED) {
+            emit_face_packed(
+                section.packed[pass],
                 pos,
-                *buffer);
+                ChunkRenderer::face_index(
+                    area_tex.min, area_specular.min),
+                d);
+            continue;
         }
-        return;
-    }
 
-    // ghost tiles rendered in transparent buffer
-    if (Chunk::GhostData::from(data)) {
-        buffer = &buffers[ChunkRenderer::PASS_TRANSPARENT];
+        emit_face(
+            section.buffers[pass],
+            t.id,
+            pos,
+            vec3(pos),
+            area_tex,
+            area_specular,
+            d);
     }
+}
 
-    // TODO: consider a dynamic_cast here to catch bad things?
-    const auto &renderer_basic =
-        static_cast<const TileRendererBasic&>(tile_renderer);
+// greedily merges faces of each direction (indexed by position in area) into
+// quads which are as large as possible, layer by layer
+static void emit_merged(
+    ChunkRenderer::Section &section,
+    const AABBi &area,
+    std::array<std::vector<MergeFace>, Direction::COUNT> &faces) {
+    const auto size = area.max - area.min + 1;
+    const auto index =
+        [&](const ivec3 &p) {
+            return (((p.x * size.y) + p.y) * size.z) + p.z;
+        };
+
+    const auto unit = ChunkRenderer::tile_unit();
 
     for (const auto &d : Direction::ALL) {
-        const auto n = pos + Direction::to_ivec3(d);
-        const auto proxy_n = chunk.or_level(n);
-        const auto &t_n = Tiles::get()[Chunk::TileData::from(proxy_n)];
+        auto &fs = faces[d];
+        const auto a = Direction::axis(d);
+        const auto a_u = FACE_AXES[d].x, a_v = FACE_AXES[d].y;
+
+        for (isize l = 0; l < size[a]; l++) {
+            for (isize v = 0; v < size[a_v]; v++) {
+                for (isize u = 0; u < size[a_u]; u++) {
+                    ivec3 p;
+                    p[a] = l;
+                    p[a_u] = u;
+                    p[a_v] = v;
+
+                    const auto face = fs[index(p)];
+                    if (face.id == 0) {
+                        continue;
+                    }
+
+                    const auto at =
+                        [&](isize du, isize dv) -> MergeFace& {
+                            auto q = p;
+                            q[a_u] += du;
+                            q[a_v] += dv;
+                            return fs[index(q)];
+                        };
+
+                    // extend along u, then along v while entire row matches
+                    isize w = 1, h = 1;
+                    while (u + w < size[a_u] && at(w, 0) == face) {
+                        w++;
+                    }
+
+                    while (v + h < size[a_v]) {
+                        bool row = true;
+                        for (isize k = 0; k < w && row; k++) {
+                            row = at(k, h) == face;
+                        }
+
+                        if (!row) {
+                            break;
+                        }
+
+                        h++;
+                    }
+
+                    for (isize dv = 0; dv < h; dv++) {
+                        for (isize du = 0; du < w; du++) {
+                            at(du, dv).id = 0;
+                        }
+                    }
+
+                    const auto pos = area.min + p;
+                    const auto pass = face.pass;
+
+                    if (ChunkRenderer::format
+                            == ChunkRenderer::FORMAT_PACKED) {
+                        emit_face_packed(
+                            section.packed[pass],
+                            pos,
+                            ChunkRenderer::face_index(
+                                face.st, face.st_specular),
+                            d,
+                            uvec2(w, h));
+                        continue;
+                    }
+
+                    emit_face(
+                        section.buffers[pass],
+                        face.id,
+                        pos,
+                        vec3(pos),
+                        TextureArea(
+                            nullptr,
+                            face.st, face.st + unit, unit, vec2(0)),
+                        TextureArea(
+                            nullptr,
+                            face.st_specular, face.st_specular + unit,
+                            unit, vec2(0)),
+                        d,
+                        uvec2(w, h));
+                }
+            }
+        }
+    }
+}
+
+ChunkRenderer::ChunkRenderer(Chunk &chunk, ChunkArena &arena)
+    : chunk(chunk),
+      arena(arena) {
+    static u64 next_id = 1;
+    this->id = next_id++;
+}
+
+ChunkRenderer::~ChunkRenderer() {
+    for (usize i = 0; i < Chunk::NUM_SECTIONS; i++) {
+        this->release(i);
+    }
+}
+
+// area (chunk space) of section i, excluding empty layers
+static AABBi section_area(const Chunk::Summary &summary, usize i) {
+    const auto
+        s = ivec3(
+            i / (Chunk::SECTIONS.y * Chunk::SECTIONS.z),
+            (i / Chunk::SECTIONS.z) % Chunk::SECTIONS.y,
+            i % Chunk::SECTIONS.z),
+        min = s * Chunk::SECTION_SIZE,
+        max = min + Chunk::SECTION_SIZE - 1;
+    return summary.clamp(AABBi(min, max));
+}
+
+void ChunkRenderer::mesh_custom(
+    Chunk &chunk,
+    Chunk::SectionMask sections,
+    std::span<Section, Chunk::NUM_SECTIONS> dst) {
+    // every tile of a uniform chunk is the same, so it has either no custom
+    // tiles at all or nothing but custom tiles
+    if (chunk.uniform()) {
+        const auto t = Chunk::TileData::from(chunk.data.get(0));
+        const auto &tile_renderer = Tiles::get()[t].renderer();
+        if (t == 0
+                || tile_renderer.is_default()
+                || !tile_renderer.custom()) {
+            return;
+        }
+    }
+
+    for (usize i = 0; i < Chunk::NUM_SECTIONS; i++) {
+        if (!(sections & (Chunk::SectionMask(1) << i))) {
+            continue;
+        }
 
-        if (proxy_n.present()
-                && !Chunk::GhostData::from(proxy_n)
-                && t_n.id != 0) {
+        const auto area = section_area(chunk.summary, i);
 
-            Tile::Transparency tt;
-            if ((tt = t_n.transparency_type()) != Tile::Transparency::OFF) {
-                if (tt == Tile::Transparency::MERGED && (t_n.id == t.id)) {
+        ivec3 pos;
+        for (pos.x = area.min.x; pos.x <= area.max.x; pos.x++) {
+            for (pos.y = area.min.y; pos.y <= area.max.y; pos.y++) {
+                if (chunk.summary.non_air[pos.y] == 0) {
                     continue;
                 }
-            } else if (t.subtile()) {
-                // only skip if full subtile
-                if (Chunk::SubtileData::from(proxy_n) == 0xFF) {
+
+                for (pos.z = area.min.z; pos.z <= area.max.z; pos.z++) {
+                    const TileId t = chunk[pos];
+                    if (t == 0) {
+                        continue;
+                    }
+
+                    const auto &tile_renderer = Tiles::get()[t].renderer();
+                    if (!tile_renderer.is_default()
+                            && tile_renderer.custom()) {
+                        tile_renderer.mesh(
+                            chunk.level,
+                            pos,
+                            dst[i].buffers[tile_renderer.pass()]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void ChunkRenderer::mesh_default(
+    const ChunkNeighborhood &neighborhood,
+    Chunk::SectionMask sections,
+    std::span<Section, Chunk::NUM_SECTIONS> dst) {
+    // faces to merge, indexed by position in section. kept per thread so
+    // that concurrent meshing does not share (or re-allocate) them.
+    static thread_local
+        std::array<std::vector<MergeFace>, Direction::COUNT> faces;
+
+    for (usize i = 0; i < Chunk::NUM_SECTIONS; i++) {
+        if (!(sections & (Chunk::SectionMask(1) << i))) {
+            continue;
+        }
+
+        auto &section = dst[i];
+
+        // skip empty layers (and so empty chunks) entirely
+        const auto area = section_area(neighborhood.summary, i);
+        const auto size = area.max - area.min + 1;
+
+        if (math::any(math::lessThanEqual(size, ivec3(0)))) {
+            continue;
+        }
+
+        if (ChunkRenderer::greedy) {
+            for (auto &fs : faces) {
+                fs.assign(size.x * size.y * size.z, MergeFace());
+            }
+        }
+
+        ivec3 pos;
+        for (pos.x = area.min.x; pos.x <= area.max.x; pos.x++) {
+            for (pos.y = area.min.y; pos.y <= area.max.y; pos.y++) {
+                if (neighborhood.summary.non_air[pos.y] == 0) {
                     continue;
                 }
-            } else {
-                // neither transparent nor partial subtile, do not show
-                continue;
+
+                for (pos.z = area.min.z; pos.z <= area.max.z; pos.z++) {
+                    const TileId t = Chunk::TileData::from(neighborhood[pos]);
+                    if (t == 0 || !Tiles::get()[t].renderer().is_default()) {
+                        continue;
+                    }
+
+                    if (!ChunkRenderer::greedy) {
+                        emit_tile(neighborhood, section, pos);
+                        continue;
+                    }
+
+                    const auto p = pos - area.min;
+                    const auto i = (((p.x * size.y) + p.y) * size.z) + p.z;
+                    std::array<MergeFace*, Direction::COUNT> fs;
+                    for (usize d = 0; d < Direction::COUNT; d++) {
+                        fs[d] = &faces[d][i];
+                    }
+
+                    emit_tile(neighborhood, section, pos, &fs);
+                }
             }
         }
 
-        emit_face(
-            renderer,
-            *buffer,
-            t.id,
-            pos,
-            vec3(pos),
-            renderer_basic.coords(chunk.level, pos_w, d),
-            renderer_basic.coords_specular(chunk.level, pos_w, d),
-            d);
+        if (ChunkRenderer::greedy) {
+            emit_merged(section, area, faces);
+        }
     }
 }
 
-ChunkRenderer::ChunkRenderer(Chunk &chunk)
-    : chunk(chunk) {
-    // TODO: why does this complain when the default size is small????
-    // shouldn't they automatically resize >:(
-
-    // TODO: pick a decent default size
-    this->vertex_buffer =
-        RDResource<bgfx::DynamicVertexBufferHandle>(
-            bgfx::createDynamicVertexBuffer(
-                4096 * 1,
-                ChunkVertex::layout,
-                BGFX_BUFFER_ALLOW_RESIZE),
-            [](auto handle) { bgfx::destroy(handle); });
-
-    // TODO: do we need 32 bit indices?
-    this->index_buffer =
-        RDResource<bgfx::DynamicIndexBufferHandle>(
-            bgfx::createDynamicIndexBuffer(
-                4096 * 1,
-                BGFX_BUFFER_ALLOW_RESIZE
-                | BGFX_BUFFER_INDEX32),
-            [](auto handle) { bgfx::destroy(handle); });
+void ChunkRenderer::release(usize i) {
+    auto &mesh = this->meshes[i];
+    if (mesh.block == -1) {
+        return;
+    }
+
+    auto &block = this->blocks[mesh.block];
+    block.live &= ~(Chunk::SectionMask(1) << i);
+    mesh.block = -1;
+
+    if (!block.live) {
+        this->arena.indices.free(block.indices);
+        this->arena.vertices.free(block.vertices);
+        this->arena.packed_vertices.free(block.packed_vertices);
+        block = Block();
+    }
 }
 
-void ChunkRenderer::mesh() {
-    // one buffer per pass
-    // NOTE: buffers are static! this way we can always keep the largest
-    // buffers around and avoid re-allocating on expansion
-    // TODO: super large buffers should (probably) be freed
-    static std::array<
-        MeshBuffer<ChunkVertex, u32>,
-        PASS_COUNT> buffers;
-
-    ivec3 pos;
-    for (pos.x = 0; pos.x < Chunk::SIZE.x; pos.x++) {
-        for (pos.y = 0; pos.y < Chunk::SIZE.y; pos.y++) {
-            for (pos.z = 0; pos.z < Chunk::SIZE.z; pos.z++) {
-                const TileId t = this->chunk[pos];
-                if (t == 0) {
-                    continue;
+void ChunkRenderer::upload(Chunk::SectionMask sections) {
+    // packed vertices may reference face textures added since last upload
+    upload_faces();
+
+    // NOTE: static, this way we can always keep the largest buffers around
+    // and avoid re-allocating on expansion
+    static std::vector<u32> indices;
+    static std::vector<ChunkVertex> vertices;
+    static std::vector<ChunkVertexPacked> vertices_packed;
+
+    indices.resize(0);
+    vertices.resize(0);
+    vertices_packed.resize(0);
+
+    // PASS_EXPOSED is skipped unless exposed, and everything else is
+    // uploaded again along with it when that changes
+    if (this->exposed != this->upload_exposed) {
+        sections = Chunk::ALL_SECTIONS;
+        this->upload_exposed = this->exposed;
+    }
+
+    const auto passes = this->exposed ? PASS_COUNT : PASS_EXPOSED;
+
+    const auto in_mask =
+        [&](usize s) {
+            return sections & (Chunk::SectionMask(1) << s);
+        };
+
+    // at most one block per section can be live and every section in the
+    // mask is released, so there is always a free block
+    for (usize s = 0; s < Chunk::NUM_SECTIONS; s++) {
+        if (in_mask(s)) {
+            this->release(s);
+        }
+    }
+
+    isize b = -1;
+    for (usize i = 0; i < this->blocks.size(); i++) {
+        if (!this->blocks[i].live) {
+            b = i;
+            break;
+        }
+    }
+    ASSERT(b != -1);
+    auto &block = this->blocks[b];
+
+    // count everything up front, indices are absolute into the arena and so
+    // need vertex ranges to be allocated first
+    usize n_indices = 0, n_vertices = 0, n_vertices_packed = 0;
+    for (usize s = 0; s < Chunk::NUM_SECTIONS; s++) {
+        if (!in_mask(s)) {
+            continue;
+        }
+
+        for (usize p = 0; p < passes; p++) {
+            const auto &full = this->sections[s].buffers[p],
+                &packed = this->sections[s].packed[p];
+            n_indices += full.indices.size() + packed.indices.size();
+            n_vertices += full.vertices.size();
+            n_vertices_packed += packed.vertices.size();
+        }
+    }
+
+    block.indices = this->arena.indices.alloc(n_indices);
+    block.vertices = this->arena.vertices.alloc(n_vertices);
+    block.packed_vertices =
+        this->arena.packed_vertices.alloc(n_vertices_packed);
+
+    // vertices are section-major, base[s][p] is the (absolute) first vertex
+    // of pass p of section s in each pool
+    usize
+        base[Chunk::NUM_SECTIONS][PASS_COUNT],
+        base_packed[Chunk::NUM_SECTIONS][PASS_COUNT];
+
+    for (usize s = 0; s < Chunk::NUM_SECTIONS; s++) {
+        if (!in_mask(s)) {
+            continue;
+        }
+
+        const auto &section = this->sections[s];
+        auto &mesh = this->meshes[s];
+
+        // bounds of all vertices, in chunk space
+        auto min = vec3(std::numeric_limits<f32>::max()),
+             max = vec3(std::numeric_limits<f32>::lowest());
+        const auto expand =
+            [&](const vec3 &p) {
+                min = math::min(min, p);
+                max = math::max(max, p);
+            };
+
+        for (usize p = 0; p < passes; p++) {
+            base[s][p] = block.vertices.offset + vertices.size();
+            base_packed[s][p] =
+                block.packed_vertices.offset + vertices_packed.size();
+
+            for (const auto &v : section.buffers[p].vertices) {
+                vertices.push_back(v);
+                expand(v.pos);
+            }
+
+            for (const auto &v : section.packed[p].vertices) {
+                vertices_packed.push_back(v);
+                expand(
+                    vec3(
+                        v.pos & 0xFF,
+                        (v.pos >> 8) & 0xFF,
+                        (v.pos >> 16) & 0xFF));
+            }
+        }
+
+        mesh.bounds = AABB(min, max);
+        mesh.block = b;
+        block.live |= Chunk::SectionMask(1) << s;
+    }
+
+    // indices are pass-major (and full then packed within each pass) so that
+    // the same pass of adjacent sections is contiguous
+    const auto append =
+        [&]<typename V>(const MeshBuffer<V, u32> &buffer, usize base) {
+            const auto start = indices.size();
+            for (const auto i : buffer.indices) {
+                indices.push_back(base + i);
+            }
+
+            return RangeAllocator::Range {
+                block.indices.offset + start,
+                indices.size() - start
+            };
+        };
+
+    for (usize p = 0; p < PASS_COUNT; p++) {
+        if (p >= passes) {
+            for (usize s = 0; s < Chunk::NUM_SECTIONS; s++) {
+                if (in_mask(s)) {
+                    this->meshes[s].passes[p] = {};
                 }
+            }
 
-                emit_tile(*this, buffers, pos);
+            continue;
+        }
+
+        for (usize s = 0; s < Chunk::NUM_SECTIONS; s++) {
+            if (in_mask(s)) {
+                this->meshes[s].passes[p].indices =
+                    append(this->sections[s].buffers[p], base[s][p]);
             }
         }
+
+        for (usize s = 0; s < Chunk::NUM_SECTIONS; s++) {
+            if (in_mask(s)) {
+                this->meshes[s].passes[p].packed_indices =
+                    append(this->sections[s].packed[p], base_packed[s][p]);
+            }
+        }
+    }
+
+    this->arena.indices.write(block.indices, indices);
+    this->arena.vertices.write(block.vertices, vertices);
+    this->arena.packed_vertices.write(block.packed_vertices, vertices_packed);
+
+    // NOTE: if a pool grew in the writes above, this block survived it but
+    // other sections of this renderer (in other blocks) did not
+    if (this->arena_generation != this->arena.generation()) {
+        bool others = false;
+        for (usize s = 0; s < Chunk::NUM_SECTIONS; s++) {
+            others = others
+                || (!in_mask(s) && this->meshes[s].block != -1);
+        }
+
+        if (!others) {
+            this->arena_generation = this->arena.generation();
+        }
     }
+}
 
-    // store indices for each pass, update buffer
-    usize num_indices = 0, num_vertices = 0;
+void ChunkRenderer::restore() {
+    if (!this->needs_restore()) {
+        return;
+    }
 
-    MeshBuffer<ChunkVertex, u32> merged;
+    // nothing uploaded yet, so nothing to lose
+    bool uploaded = false;
+    for (const auto &mesh : this->meshes) {
+        uploaded = uploaded || mesh.block != -1;
+    }
 
-    // preallocate merged data, compute pass indices
-    for (usize i = 0; i < buffers.size(); i++) {
-        const auto &buffer = buffers[i];
+    if (!uploaded) {
+        this->arena_generation = this->arena.generation();
+        this->upload_exposed = this->exposed;
+        return;
+    }
 
-        this->passes[i] = {
-            std::make_tuple(num_indices, buffer.num_indices()),
-            std::make_tuple(num_vertices, buffer.num_vertices()),
-        };
+    // sections always hold the current mesh of every section, so all of them
+    // can be re-uploaded (into one block) as-is
+    this->upload(Chunk::ALL_SECTIONS);
+}
+
+void ChunkRenderer::mesh(Chunk::SectionMask sections) {
+    for (usize i = 0; i < Chunk::NUM_SECTIONS; i++) {
+        if (!(sections & (Chunk::SectionMask(1) << i))) {
+            continue;
+        }
+
+        this->sections[i].clear();
+    }
 
-        if (buffer.num_vertices() == 0) {
-            ASSERT(buffer.num_indices() == 0);
+    ChunkRenderer::mesh_custom(this->chunk, sections, this->sections);
+    ChunkRenderer::mesh_default(
+        ChunkNeighborhood(this->chunk), sections, this->sections);
+    this->upload(sections);
+}
+
+void ChunkRenderer::apply(
+    usize version,
+    Chunk::SectionMask sections,
+    std::span<Section, Chunk::NUM_SECTIONS> src) {
+    for (usize i = 0; i < Chunk::NUM_SECTIONS; i++) {
+        if (sections & (Chunk::SectionMask(1) << i)) {
+            std::swap(this->sections[i], src[i]);
+        }
+    }
+
+    this->upload(sections);
+    this->mesh_version = version;
+    this->pending_version = 0;
+}
+
+std::span<const ChunkRenderer::Extra> ChunkRenderer::extras() {
+    if (this->extras_version == this->chunk.render_version) {
+        return this->visible_extras;
+    }
+
+    this->extras_version = this->chunk.render_version;
+    this->visible_extras.clear();
+
+    // keep instance storage around, it is likely to be the same size
+    for (auto &[_, is] : this->instances) {
+        is.data.clear();
+        is.meshes.clear();
+    }
+
+    for (const auto index : this->chunk.extras) {
+        const auto pos =
+            this->chunk.offset_tiles
+                + ivec3(Chunk::Offset::from_raw(index));
+        if (!this->chunk.level->visible(pos)) {
             continue;
         }
 
-        num_indices += buffer.num_indices();
-        num_vertices += buffer.num_vertices();
-    }
-
-    merged.indices.reserve(num_indices);
-    merged.vertices.reserve(num_vertices);
-
-    // merge data
-    for (auto &buffer : buffers) {
-        merged.indices.insert(
-            merged.indices.end(),
-            buffer.indices.begin(),
-            buffer.indices.end());
-        merged.vertices.insert(
-            merged.vertices.end(),
-            buffer.vertices.begin(),
-            buffer.vertices.end());
-
-        // clear buffer
-        // use resize(0) as it is guaranteed not to change capacity
-        buffer.indices.resize(0);
-        buffer.vertices.resize(0);
-    }
-
-    // TODO: eliminate this copy
-    // upload
-    if (num_indices != 0 && num_vertices != 0) {
-        bgfx::update(
-            this->index_buffer, 0,
-            bgfx::copy(
-                &merged.indices[0],
-                merged.num_indices() * sizeof(merged.indices[0])));
-
-        bgfx::update(
-            this->vertex_buffer, 0,
-            bgfx::copy(
-                &merged.vertices[0],
-                merged.num_vertices() * sizeof(merged.vertices[0])));
+        const auto &renderer =
+            Tiles::get()[Chunk::TileData::from(this->chunk.data.get(index))]
+                .renderer();
+        auto &extra =
+            this->visible_extras.emplace_back(Extra { pos, &renderer });
+
+        if (renderer.has_instanced_extras()) {
+            auto &is = this->instances[&renderer];
+            extra.offset = is.data.size();
+            renderer.instance_extras(
+                this->chunk.level, pos, is.data, is.meshes);
+            extra.count = is.data.size() - extra.offset;
+            ASSERT(is.data.size() == is.meshes.size());
+        }
     }
+
+    return this->visible_extras;
+}
+
+vec2 ChunkRenderer::tile_unit() {
+    return TextureAtlas::get().texel() * vec2(SCALE);
 }
 
+// draws pass of the sections in mask. sections are drawn together where their
+// indices are contiguous in the arena (see ChunkRenderer::Block), so a chunk
+// which was uploaded at once is usually one draw per pass and format.
 static void render_pass(
-    ChunkRenderer &chunk_renderer,
+    const ChunkRenderer &renderer,
+    Chunk::SectionMask mask,
     ChunkRenderer::Pass pass,
     const mat4 &model,
     RenderState render_state,
-    f64 alpha = 1.0) {
-    const auto [offset_indices, num_indices] =
-        chunk_renderer.passes[pass].indices_start_num;
-    const auto [offset_vertices, num_vertices] =
-        chunk_renderer.passes[pass].vertices_start_num;
+    f64 alpha = 1.0,
+    const vec4 &ghost = vec4(0)) {
+    const auto &arena = renderer.arena;
+    const auto unit = ChunkRenderer::tile_unit();
+
+    const auto submit =
+        [&](const Program &program,
+            bgfx::DynamicVertexBufferHandle vertex_buffer,
+            usize num_vertices,
+            const RangeAllocator::Range &indices) {
+            // indices are absolute, so always draw from vertex zero
+            bgfx::setVertexBuffer(0, vertex_buffer, 0, num_vertices);
+            bgfx::setIndexBuffer(
+                arena.indices.buffer, indices.offset, indices.size);
+
+            program.set("s_tex", 0, TextureAtlas::get());
+            program.try_set("u_tile_unit", vec4(unit, unit));
+            program.try_set("u_color", vec4(0));
+            program.try_set("u_alpha", vec4(alpha));
+            program.try_set("u_flags_id", vec4(0));
+            program.try_set("u_ghost", ghost);
+
+            if (ghost.x != 0.0f) {
+                global.game->occlusion_map->set_ghost_uniforms(program, 1);
+            }
 
-    if (num_indices == 0) {
-        return;
-    }
+            bgfx::setTransform(math::value_ptr(model));
+            Renderer::get().submit(program, render_state.or_defaults());
+        };
+
+    // calls f on each contiguous run of section index ranges given by range
+    const auto runs =
+        [&](auto &&range, auto &&f) {
+            RangeAllocator::Range run;
+            for (usize i = 0; i < Chunk::NUM_SECTIONS; i++) {
+                if (!(mask & (Chunk::SectionMask(1) << i))) {
+                    if (!run.empty()) {
+                        f(run);
+                    }
+
+                    run = RangeAllocator::Range();
+                    continue;
+                }
+
+                const auto &r = range(renderer.meshes[i].passes[pass]);
+                if (r.empty()) {
+                    continue;
+                } else if (!run.empty() && run.end() == r.offset) {
+                    run.size += r.size;
+                } else {
+                    if (!run.empty()) {
+                        f(run);
+                    }
+
+                    run = r;
+                }
+            }
 
-    bgfx::setVertexBuffer(
-        0, chunk_renderer.vertex_buffer, offset_vertices, num_vertices);
-    bgfx::setIndexBuffer(
-        chunk_renderer.index_buffer, offset_indices, num_indices);
+            if (!run.empty()) {
+                f(run);
+            }
+        };
 
-    const auto &program = Renderer::get().programs["chunk"];
-    program.set("s_tex", 0, TextureAtlas::get());
-    program.try_set("u_color", vec4(0));
-    program.try_set("u_alpha", vec4(alpha));
-    program.try_set("u_flags_id", vec4(0));
-    bgfx::setTransform(math::value_ptr(model));
-    Renderer::get().submit(program, render_state.or_defaults());
+    runs(
+        [](const auto &p) -> const auto& { return p.indices; },
+        [&](const RangeAllocator::Range &r) {
+            submit(
+                Renderer::get().programs["chunk"],
+                arena.vertices.buffer,
+                arena.vertices.buffer_capacity,
+                r);
+        });
+
+    runs(
+        [](const auto &p) -> const auto& { return p.packed_indices; },
+        [&](const RangeAllocator::Range &r) {
+            bgfx::setBuffer(
+                BUFFER_INDEX_CHUNK_FACES,
+                face_buffer.get(),
+                bgfx::Access::Read);
+            submit(
+                Renderer::get().programs["chunk_packed"],
+                arena.packed_vertices.buffer,
+                arena.packed_vertices.buffer_capacity,
+                r);
+        });
 }
 
-void ChunkRenderer::render(RenderContext &ctx) {
+void ChunkRenderer::update() {
     if (this->chunk.render_version == 0) {
         return;
     }
 
-    // re-mesh if dirty
-    if (this->chunk.render_version != this->mesh_version) {
-        this->mesh();
+    // re-mesh dirty sections synchronously if nothing else (i.e. ChunkMesher)
+    // is, see remesh_sections()
+    if (this->needs_mesh() && this->pending_version == 0) {
+        this->mesh(this->remesh_sections());
+        this->chunk.dirty_sections = 0;
         this->mesh_version = this->chunk.render_version;
     }
+}
+
+void ChunkRenderer::render(
+    RenderContext &ctx,
+    Chunk::SectionMask mask,
+    u8 passes) {
+    passes &=
+        RENDER_FLAG_PASS_BASE
+        | RENDER_FLAG_PASS_SHADOW
+        | RENDER_FLAG_PASS_TRANSPARENT;
+
+    if (!mask || !passes) {
+        return;
+    }
+
+    // ghosting only needs to be resolved if there are ghost tiles nearby
+    const auto ghosts =
+        global.game->occlusion_map->ghost_chunks.contains(this->chunk.offset);
 
     auto *model = ctx.allocator->alloc<mat4>(mat4(1.0));
     *model = math::translate(*model, vec3(this->chunk.offset_tiles));
 
     ctx.push(
         RenderCtxFn {
-            [this, model](const RenderGroup&, RenderState render_state) {
+            [this, model, mask, ghosts](
+                const RenderGroup&,
+                RenderState render_state) {
+                // see Pass and u_ghost in fs_chunk for ghost modes
                 if (render_state.flags & RENDER_FLAG_PASS_TRANSPARENT) {
                     render_pass(
-                        *this, PASS_TRANSPARENT, *model, render_state, 0.5f);
+                        *this, mask, PASS_TRANSPARENT, *model, render_state,
+                        0.5f);
+
+                    if (ghosts) {
+                        render_pass(
+                            *this, mask, PASS_DEFAULT, *model, render_state,
+                            0.5f, vec4(1, 1, 0, 0));
+                        render_pass(
+                            *this, mask, PASS_EXPOSED, *model, render_state,
+                            0.5f, vec4(1, 1, 1, 0));
+                    }
                 } else if (render_state.flags &
-                            (RENDER_FLAG_PASS_BASE | RENDER_FLAG_PASS_SHADOW)) {
+                            (RENDER_FLAG_PASS_BASE
+                                | RENDER_FLAG_PASS_SHADOW)) {
                     render_pass(
-                        *this, PASS_DEFAULT, *model, render_state);
+                        *this, mask, PASS_DEFAULT, *model, render_state,
+                        1.0f, ghosts ? vec4(1, 0, 0, 0) : vec4(0));
+
+                    if (ghosts) {
+                        render_pass(
+                            *this, mask, PASS_EXPOSED, *model, render_state,
+                            1.0f, vec4(1, 0, 1, 0));
+                    }
                 }
             },
-            RENDER_FLAG_PASS_BASE
-                | RENDER_FLAG_PASS_SHADOW
-                | RENDER_FLAG_PASS_TRANSPARENT
+            passes
         });
-
 }
@@ -3,11 +3,18 @@
 #include "util/types.hpp"
 #include "util/util.hpp"
 #include "util/math.hpp"
+#include "util/aabb.hpp"
+#include "util/range_allocator.hpp"
 #include "gfx/vertex.hpp"
 #include "gfx/util.hpp"
+#include "gfx/mesh_buffer.hpp"
+#include "gfx/multi_mesh_instancer.hpp"
+#include "level/chunk.hpp"
+#include "level/chunk_neighborhood.hpp"
 
-struct Chunk;
 struct RenderContext;
+struct ChunkArena;
+struct TileRenderer;
 
 struct ChunkVertex : public VertexType<ChunkVertex> {
     static bgfx::VertexLayout layout;
@@ -19,37 +26,341 @@ struct ChunkVertex : public VertexType<ChunkVertex> {
 
     // ideally would be u16 BUT Vulkan under Metal requires that vertex strides
     // are aligned to 4 bytes
+    // tile id is in the low 16 bits, see pack_tile_id() for the rest
     u32 tile_id;
 
     ChunkVertex() = default;
+
+    // packs tile id along with texture repeat information for (possibly
+    // greedy merged) faces. for each of u and v, one byte holds the number of
+    // times the face texture repeats minus one (low 7 bits) and whether this
+    // vertex is on the far side of the face (high bit). zero is a face with
+    // no repeat, which is what every non-chunk mesh uses.
+    static inline u32 pack_tile_id(
+        TileId id,
+        const uvec2 &corner = uvec2(0),
+        const uvec2 &repeat = uvec2(1)) {
+        ASSERT(math::all(math::greaterThan(repeat, uvec2(0))));
+        ASSERT(math::all(math::lessThanEqual(repeat, uvec2(128))));
+        return u32(id)
+            | (((repeat.x - 1) | (corner.x << 7)) << 16)
+            | (((repeat.y - 1) | (corner.y << 7)) << 24);
+    }
 } PACKED;
 
 DECL_VERTEX_TYPE_HEADER(ChunkVertex)
 
+// compact vertex for faces of default-rendered tiles, 8 bytes instead of the
+// 44 of ChunkVertex. see ChunkRenderer::Format.
+//
+// as these faces are always axis aligned, of whole tiles and textured with
+// repeatable tile_unit() textures, position fits in bytes (chunk space),
+// normal is a direction and texture coordinates are derived in the vertex
+// shader from an index into a shared table of face textures (see
+// ChunkRenderer::face_index()) and the corner of the face.
+struct ChunkVertexPacked : public VertexType<ChunkVertexPacked> {
+    static bgfx::VertexLayout layout;
+
+    // bytes: x, y, z, direction | (corner u << 3) | (corner v << 4)
+    u32 pos;
+
+    // bytes: face texture index (low, high), repeat u - 1, repeat v - 1
+    u32 face;
+
+    ChunkVertexPacked() = default;
+    ChunkVertexPacked(
+        const ivec3 &pos,
+        Direction::Enum direction,
+        const uvec2 &corner,
+        u16 face,
+        const uvec2 &repeat) {
+        ASSERT(math::all(math::greaterThanEqual(pos, ivec3(0))));
+        ASSERT(math::all(math::lessThanEqual(pos, Chunk::SIZE)));
+        ASSERT(math::all(math::greaterThan(repeat, uvec2(0))));
+        ASSERT(math::all(math::lessThanEqual(repeat, uvec2(256))));
+        this->pos =
+            u32(pos.x)
+                | (u32(pos.y) << 8)
+                | (u32(pos.z) << 16)
+                | ((direction | (corner.x << 3) | (corner.y << 4)) << 24);
+        this->face =
+            u32(face)
+                | ((repeat.x - 1) << 16)
+                | ((repeat.y - 1) << 24);
+    }
+} PACKED;
+
+DECL_VERTEX_TYPE_HEADER(ChunkVertexPacked)
+
 struct ChunkRenderer {
     // chunk mesh passes, used to separate out different parts of chunk meshes
     // if necessary
+    // ghost tiles (see Chunk::GhostData) are not meshed any differently,
+    // they are resolved at draw time against OcclusionMap's ghost texture:
+    // PASS_DEFAULT fragments of ghost tiles are drawn transparent instead of
+    // opaque, and PASS_EXPOSED (faces which are only hidden by a neighbor)
+    // fragments are only drawn if that neighbor is a ghost. PASS_EXPOSED is
+    // always meshed but only uploaded for chunks near ghost tiles, see
+    // exposed.
     enum Pass {
         PASS_DEFAULT = 0,
         PASS_TRANSPARENT = 1,
-        PASS_COUNT = PASS_TRANSPARENT + 1
+        PASS_EXPOSED = 2,
+        PASS_COUNT = PASS_EXPOSED + 1
     };
 
+    // vertex format of default-rendered tile faces. custom meshers (and
+    // faces with non-repeatable textures) always use ChunkVertex.
+    enum Format {
+        FORMAT_FULL = 0,
+        FORMAT_PACKED
+    };
+
+    // if true, coplanar faces of default-rendered tiles with the same
+    // textures are merged into larger quads when meshing
+    static inline bool greedy = true;
+
+    // format used for default-rendered tile faces when meshing
+    static inline Format format = FORMAT_PACKED;
+
     Chunk &chunk;
 
-    // buffer indices for each pass
-    struct {
-        std::tuple<usize, usize> indices_start_num, vertices_start_num;
-    } passes[PASS_COUNT];
+    // geometry storage, shared by all chunk renderers of a LevelRenderer
+    ChunkArena &arena;
 
-    // version of the chunk (Chunk::version) when it was last meshed
+    // unique id, used to match asynchronous mesh results to this renderer as
+    // chunk renderers can be destroyed and re-created at the same offset
+    u64 id;
+
+    // CPU-side geometry of each chunk section (see Chunk::dirty_sections),
+    // kept so that only dirty sections need to be remeshed and so that the
+    // arena can be restored after it grows (see restore())
+    struct Section {
+        std::array<MeshBuffer<ChunkVertex, u32>, PASS_COUNT> buffers;
+        std::array<MeshBuffer<ChunkVertexPacked, u32>, PASS_COUNT> packed;
+
+        inline void clear() {
+            // use resize(0) as it is guaranteed not to change capacity
+            for (auto &buffer : this->buffers) {
+                buffer.indices.resize(0);
+                buffer.vertices.resize(0);
+            }
+
+            for (auto &buffer : this->packed) {
+                buffer.indices.resize(0);
+                buffer.vertices.resize(0);
+            }
+        }
+    };
+
+    std::array<Section, Chunk::NUM_SECTIONS> sections;
+
+    // GPU-side geometry of each chunk section, drawn and culled
+    // independently. geometry lives in ChunkArena, see Block.
+    struct SectionMesh {
+        // ranges of arena indices for each pass, packed_indices index into
+        // the packed vertex pool
+        struct {
+            RangeAllocator::Range indices, packed_indices;
+        } passes[PASS_COUNT];
+
+        // (chunk space) bounds of all geometry, only valid if !empty()
+        AABB bounds;
+
+        // index into blocks of the block holding this section, -1 if none
+        isize block = -1;
+
+        // true if there is nothing to draw in any pass
+        inline bool empty() const {
+            for (const auto &p : this->passes) {
+                if (!p.indices.empty() || !p.packed_indices.empty()) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    };
+
+    // arena ranges holding the geometry of the sections of one upload(),
+    // laid out pass-major so that the same pass of adjacent sections is
+    // contiguous and can be drawn together. freed once none of its sections
+    // are live.
+    struct Block {
+        RangeAllocator::Range indices, vertices, packed_vertices;
+        Chunk::SectionMask live = 0;
+    };
+
+    std::array<SectionMesh, Chunk::NUM_SECTIONS> meshes;
+
+    // at most one block per section is ever live
+    std::array<Block, Chunk::NUM_SECTIONS> blocks;
+
+    // Chunk::render_version when the chunk was last meshed
     usize mesh_version = 0;
 
-    RDResource<bgfx::DynamicIndexBufferHandle> index_buffer;
-    RDResource<bgfx::DynamicVertexBufferHandle> vertex_buffer;
+    // version of the chunk which is being meshed asynchronously, 0 if none
+    usize pending_version = 0;
+
+    // true if faces which are only hidden by a neighbor (PASS_EXPOSED) should
+    // be uploaded. set by LevelRenderer while the chunk is in
+    // OcclusionMap::ghost_chunks. sections always keep them, so a change only
+    // re-uploads (see restore()) and never remeshes.
+    bool exposed = false;
+
+    // value of exposed as of the last upload
+    bool upload_exposed = false;
+
+    // ChunkArena::generation() as of the last upload, see restore()
+    usize arena_generation = 0;
+
+    // extras tile (see Chunk::extras) which is not enclosed by solid tiles
+    struct Extra {
+        // level space
+        ivec3 pos;
+
+        const TileRenderer *renderer;
+
+        // range of this tile's instances in instances[renderer], only used
+        // if renderer->has_instanced_extras()
+        u32 offset = 0, count = 0;
+    };
+
+    // instanced extras of every visible extras tile with the same renderer,
+    // see TileRenderer::instance_extras
+    struct Instances {
+        std::vector<ModelInstanceData> data;
+        std::vector<const MultiMeshEntry*> meshes;
+    };
+
+    // see extras()
+    std::vector<Extra> visible_extras;
+    std::unordered_map<const TileRenderer*, Instances> instances;
+
+    // version of the chunk (Chunk::render_version) when visible_extras and
+    // instances were last computed
+    u64 extras_version = 0;
+
+    ChunkRenderer(Chunk &chunk, ChunkArena &arena);
+    ~ChunkRenderer();
+
+    // NOTE: not copyable or moveable, arena ranges are freed on destruction
+    ChunkRenderer(const ChunkRenderer &other) = delete;
+    ChunkRenderer(ChunkRenderer &&other) = delete;
+    ChunkRenderer &operator=(const ChunkRenderer &other) = delete;
+    ChunkRenderer &operator=(ChunkRenderer &&other) = delete;
+
+    // true if chunk has changed since it was last meshed
+    inline bool needs_mesh() const {
+        return this->chunk.render_version != this->mesh_version;
+    }
+
+    // sections to remesh if needs_mesh(), everything if this is the first
+    // mesh
+    inline Chunk::SectionMask remesh_sections() const {
+        return this->mesh_version == 0 ?
+            Chunk::ALL_SECTIONS
+            : this->chunk.dirty_sections;
+    }
+
+    // remesh sections in mask and re-upload their geometry
+    void mesh(Chunk::SectionMask sections = Chunk::ALL_SECTIONS);
+
+    // swaps in sections in mask from src (as meshed from chunk version) and
+    // re-uploads their geometry
+    void apply(
+        usize version,
+        Chunk::SectionMask sections,
+        std::span<Section, Chunk::NUM_SECTIONS> src);
+
+    // re-meshes dirty sections synchronously if nothing else (i.e.
+    // ChunkMesher) is meshing them, call before cull()/render()
+    void update();
+
+    // true if the arena has lost this renderer's geometry since its last
+    // upload (see ChunkArena) or if exposed has changed since then
+    inline bool needs_restore() const {
+        return this->arena_generation != this->arena.generation()
+            || this->exposed != this->upload_exposed;
+    }
+
+    // re-uploads every section from CPU-side sections if needs_restore()
+    void restore();
+
+    // world space bounds of each section into dst, returns mask of those
+    // with geometry. bounds of empty sections are unspecified.
+    Chunk::SectionMask section_bounds(
+        std::span<AABB, Chunk::NUM_SECTIONS> dst) const {
+        Chunk::SectionMask mask = 0;
+
+        if (this->chunk.render_version == 0) {
+            return mask;
+        }
+
+        for (usize i = 0; i < Chunk::NUM_SECTIONS; i++) {
+            const auto &mesh = this->meshes[i];
+            dst[i] = mesh.bounds.translate(vec3(this->chunk.offset_tiles));
+
+            if (!mesh.empty()) {
+                mask |= Chunk::SectionMask(1) << i;
+            }
+        }
+
+        return mask;
+    }
+
+    // sections with geometry whose world space bounds pass f
+    template <typename F>
+    Chunk::SectionMask cull(F &&f) const {
+        std::array<AABB, Chunk::NUM_SECTIONS> bounds;
+        auto mask = this->section_bounds(bounds);
+
+        for (usize i = 0; i < Chunk::NUM_SECTIONS; i++) {
+            const auto bit = Chunk::SectionMask(1) << i;
+            if ((mask & bit) && !f(bounds[i])) {
+                mask &= ~bit;
+            }
+        }
+
+        return mask;
+    }
+
+    // pushes draws of sections in mask to ctx, only for RENDER_FLAG_PASS_*
+    // in passes. each view (camera, sun) culls and renders separately.
+    void render(RenderContext &ctx, Chunk::SectionMask mask, u8 passes);
+
+    // visible extras tiles in chunk along with their instances, only
+    // recomputed when the chunk (or a neighbor's bordering tile) has changed
+    std::span<const Extra> extras();
+
+    // meshes tiles with custom tile renderers in sections into dst. these
+    // read the level and so must be meshed on the main thread.
+    static void mesh_custom(
+        Chunk &chunk,
+        Chunk::SectionMask sections,
+        std::span<Section, Chunk::NUM_SECTIONS> dst);
+
+    // meshes default-rendered tiles in sections into dst, safe to call from
+    // any thread
+    static void mesh_default(
+        const ChunkNeighborhood &neighborhood,
+        Chunk::SectionMask sections,
+        std::span<Section, Chunk::NUM_SECTIONS> dst);
+
+    // size of one repeat of a tile face texture in the atlas, faces can only
+    // be merged if their textures are this size
+    static vec2 tile_unit();
+
+    // index of face texture (st, st_specular) in the table read by packed
+    // vertices, added if not present. safe to call from any thread, lookups
+    // are cached per thread.
+    static u16 face_index(const vec2 &st, const vec2 &st_specular);
 
-    explicit ChunkRenderer(Chunk &chunk);
+private:
+    // uploads sections in mask to the GPU, main thread only
+    void upload(Chunk::SectionMask sections);
 
-    void mesh();
-    void render(RenderContext &ctx);
+    // frees the geometry of section i, if it is the last live section of its
+    // block
+    void release(usize i);
 };
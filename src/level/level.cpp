@@ -98,14 +98,40 @@ Level::Level(
     // place chunks
     for (int x = 0; x < this->size.x; x++) {
         for (int z = 0; z < this->size.y; z++) {
-            const auto offset = ivec2(x, z);
-            this->chunks[Level::to_index(offset)] =
-                make_alloc_ptr<Chunk>(this->chunk_allocator, *this, offset);
+            this->place_chunk(
+                make_alloc_ptr<Chunk>(
+                    this->chunk_allocator, *this, ivec2(x, z)),
+                false);
         }
     }
 
-    // generate level
+    // generate level in one transaction, incremental lighting is superseded
+    // by a full bake at the end
+    this->begin_edit();
     generate(*this);
+    this->edit.light_removals.clear();
+    this->edit.light_additions.clear();
+    this->edit.light_updates.clear();
+    this->light_engine.bake(*this);
+    this->commit_edit();
+}
+
+Level::Level(
+    Allocator *allocator,
+    usize depth,
+    const ivec2 &size,
+    LevelStreamer &&streamer)
+    : depth(depth),
+      size(size) {
+    init_allocators(*this, allocator);
+    init(*this);
+
+    this->chunks =
+        List<alloc_ptr<Chunk>>(
+            &this->allocator,
+            this->size.x * this->size.y);
+
+    this->streamer = std::move(streamer);
 }
 
 void Level::on_before_deserialize(SerializationContextLevel &ctx) {
@@ -114,16 +140,35 @@ void Level::on_before_deserialize(SerializationContextLevel &ctx) {
 
 void Level::on_resolve(SerializationContextLevel &ctx) {
     init(*this);
+
+    this->loaded_chunks.clear();
+    for (auto &chunk : this->chunks) {
+        if (chunk) {
+            this->loaded_chunks.push_back(chunk.get());
+        }
+    }
+
+    this->paged_entities.reset();
+    if (this->streamer) {
+        for (const auto &page : this->streamer->pages) {
+            for (const auto id : page.entities) {
+                this->paged_entities.set(id);
+            }
+        }
+    }
+
+    // NOTE: chunks are resolved (and their emitters rebuilt) before the level
+    this->light_engine.bake(*this);
 }
 
 void Level::update() {
-    for (auto &chunk : this->chunks) {
+    for (auto *chunk : this->loaded_chunks) {
         chunk->update();
     }
 }
 
 void Level::tick() {
-    for (auto &chunk : this->chunks) {
+    for (auto *chunk : this->loaded_chunks) {
         chunk->tick();
     }
 
@@ -142,6 +187,198 @@ void Level::tick() {
     }
 }
 
+void Level::begin_edit() {
+    if (this->edit.depth++ != 0) {
+        return;
+    }
+
+    for (auto *chunk : this->loaded_chunks) {
+        chunk->in_edit = true;
+    }
+}
+
+void Level::commit_edit() {
+    ASSERT(this->edit.depth != 0, "commit without begin_edit");
+
+    if (--this->edit.depth != 0) {
+        return;
+    }
+
+    // no longer in edit, but chunks still defer their version bumps until
+    // lighting is done
+    auto removals = std::move(this->edit.light_removals);
+    auto updates = std::move(this->edit.light_updates);
+    auto queued = std::move(this->edit.light_additions);
+    this->edit.light_removals.clear();
+    this->edit.light_updates.clear();
+    this->edit.light_additions.clear();
+
+    // additions are applied after all removals, so keep only those which
+    // were not followed by a removal at the same position
+    std::vector<std::tuple<ivec3, u8>> additions;
+    if (!queued.empty()) {
+        std::unordered_map<ivec3, usize> last_removal;
+        for (usize i = 0; i < removals.size(); i++) {
+            last_removal[std::get<0>(removals[i])] = i + 1;
+        }
+
+        additions.reserve(queued.size());
+        for (const auto &[pos, light, n_removals] : queued) {
+            const auto it = last_removal.find(pos);
+            if (it == last_removal.end() || it->second <= n_removals) {
+                additions.emplace_back(pos, light);
+            }
+        }
+    }
+
+    // many edits may touch the same tile
+    const auto less =
+        [](const ivec3 &a, const ivec3 &b) {
+            return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+        };
+    std::sort(updates.begin(), updates.end(), less);
+    updates.erase(std::unique(updates.begin(), updates.end()), updates.end());
+
+    // all removals, additions and updates of the transaction in a single pass
+    this->light_engine.propagate(*this, removals, additions, updates);
+
+    // one version bump per touched chunk
+    for (auto *chunk : this->loaded_chunks) {
+        chunk->in_edit = false;
+        chunk->flush_bumps();
+    }
+}
+
+void Level::reconcile_borders(const ivec2 &offset) {
+    auto *chunk = this->chunkp(offset);
+
+    // light saved with a paged in chunk is removed and refilled, light from
+    // resident chunks is re-propagated into it and light left in the
+    // neighbors of an evicted chunk is removed
+    std::vector<std::tuple<ivec3, u8>> removals;
+    std::vector<ivec3> updates;
+
+    for (const auto d : Direction::CARDINAL) {
+        const auto dv = Direction::to_ivec3(d);
+        auto *neighbor = this->chunkp(offset + dv.xz());
+
+        if (!neighbor) {
+            continue;
+        }
+
+        neighbor->bump(true);
+
+        // border layer of neighbor facing offset
+        const auto axis = Direction::axis(d);
+        const auto other = 2 - axis;
+        const isize border = dv[axis] > 0 ? 0 : (Chunk::SIZE[axis] - 1);
+
+        for (isize y = 0; y < Chunk::SIZE.y; y++) {
+            for (isize a = 0; a < Chunk::SIZE[other]; a++) {
+                ivec3 pos(0, y, 0);
+                pos[axis] = border;
+                pos[other] = a;
+                neighbor->mark_dirty(pos);
+
+                const auto pos_n = neighbor->offset_tiles + pos;
+                const u8 light_n = this->light[pos_n];
+
+                if (light_n == 0) {
+                    continue;
+                } else if (chunk) {
+                    updates.push_back(pos_n);
+                } else {
+                    removals.emplace_back(pos_n, light_n);
+                }
+            }
+        }
+
+        if (!chunk) {
+            continue;
+        }
+
+        // matching layer of chunk across the border
+        for (isize y = 0; y < Chunk::SIZE.y; y++) {
+            for (isize a = 0; a < Chunk::SIZE[other]; a++) {
+                ivec3 pos(0, y, 0);
+                pos[axis] = (Chunk::SIZE[axis] - 1) - border;
+                pos[other] = a;
+
+                const auto pos_c = chunk->offset_tiles + pos;
+                const u8 light_c = this->light[pos_c];
+
+                if (light_c != 0) {
+                    removals.emplace_back(pos_c, light_c);
+                }
+            }
+        }
+    }
+
+    if (removals.empty() && updates.empty()) {
+        return;
+    }
+
+    this->begin_edit();
+    Light::remove(*this, removals);
+    Light::update(*this, updates);
+
+    // removal can also clear weaker emitters nearby, re-add all of them
+    for (isize x = -1; x <= 1; x++) {
+        for (isize z = -1; z <= 1; z++) {
+            const auto *c = this->chunkp(offset + ivec2(x, z));
+
+            if (!c) {
+                continue;
+            }
+
+            for (const auto index : c->emitters) {
+                if (const auto value =
+                        LightEngine::emission(*this, *c, index)) {
+                    Light::add(
+                        *this,
+                        c->offset_tiles + Chunk::Offset::from_raw(index),
+                        value);
+                }
+            }
+        }
+    }
+
+    this->commit_edit();
+}
+
+Chunk &Level::place_chunk(alloc_ptr<Chunk> &&chunk, bool reconcile) {
+    const auto index = this->to_index(chunk->offset);
+    ASSERT(
+        index < this->chunks.size() && !this->chunks[index],
+        "cannot place chunk at {}",
+        chunk->offset);
+
+    auto &ptr = (this->chunks[index] = std::move(chunk));
+    ptr->in_edit = this->in_edit();
+    this->loaded_chunks.push_back(ptr.get());
+
+    if (reconcile) {
+        this->reconcile_borders(ptr->offset);
+    }
+
+    return *ptr;
+}
+
+alloc_ptr<Chunk> Level::remove_chunk(const ivec2 &offset) {
+    const auto index = this->to_index(offset);
+    ASSERT(
+        index < this->chunks.size() && this->chunks[index],
+        "no chunk at {}",
+        offset);
+
+    auto chunk = std::move(this->chunks[index]);
+    std::erase(this->loaded_chunks, chunk.get());
+    chunk->in_edit = false;
+    chunk->flush_bumps();
+    this->reconcile_borders(offset);
+    return chunk;
+}
+
 Entity *Level::spawn(
     alloc_ptr<Entity> &&_entity,
     const vec3 &pos) {
@@ -152,6 +389,12 @@ Entity *Level::spawn(
     entity->level = this;
     entity->pos = pos;
 
+    // chunks which are paged out (streaming levels) cannot hold entities
+    if (this->is_chunk_unloaded(Level::to_offset(Level::to_tile(pos)))) {
+        WARN("could not spawn entity, chunk at {} is not loaded", pos);
+        return nullptr;
+    }
+
     if (!entity->check_spawn_collision()) {
         goto done;
     }
@@ -270,26 +513,10 @@ std::tuple<usize, bool> Level::entities(
         return std::make_tuple(0, false);
     }
 
-    const auto &entities =
-        c->get_xz_entities(Level::to_chunk_pos(ivec3(xz.x, 0, xz.y)).xz());
-
-    usize n = 0;
-    bool overflow = false;
-
-    for (auto *e : entities) {
-        if (filter && !(*filter)(*e)) {
-            continue;
-        }
-
-        if (n >= dest.size()) {
-            overflow = true;
-            break;
-        }
-
-        dest[n++] = e;
-    }
-
-    return std::make_tuple(n, overflow);
+    return c->get_entities(
+        dest,
+        Level::to_chunk_pos(ivec3(xz.x, 0, xz.y)).xz(),
+        filter);
 }
 
 std::tuple<usize, bool> Level::tile_colliders(
@@ -489,25 +716,25 @@ std::tuple<usize, bool> Level::lights(
 }
 
 std::optional<std::tuple<usize, TileId>> Level::topmost_tile(const ivec2 &xz) {
-    for (isize y = Chunk::SIZE.y - 1; y >= 0; y--) {
-        TileId t;
-        if ((t = this->tiles[{ xz.x, y, xz.y }]) != 0) {
-            return std::make_tuple(y, t);
-        }
+    const auto h = this->height(xz);
+    if (h == 0) {
+        return std::nullopt;
     }
 
-    return std::nullopt;
+    const auto y = h - 1;
+    return std::make_tuple(y, TileId(this->tiles[{ xz.x, isize(y), xz.y }]));
 }
 
 bool Level::visible(const ivec3 &pos) const {
     usize n = 0;
-    for (const auto &d : Direction::ALL) {
-        const auto pos_n = pos + Direction::to_ivec3(d);
-        const auto tile = this->tiles[pos_n];
-        if (tile != 0 && Tiles::get()[tile].solid(*this, pos_n)) {
-            n++;
-        }
-    }
+    this->for_each_neighbor(
+        pos,
+        [&](Direction::Enum, const ivec3 &pos_n, Chunk &chunk, u16 i) {
+            const auto tile = Chunk::TileData::from(chunk.data.get(i));
+            if (tile != 0 && Tiles::get()[tile].solid(*this, pos_n)) {
+                n++;
+            }
+        });
     return n != Direction::COUNT;
 }
 
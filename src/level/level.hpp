@@ -9,8 +9,11 @@
 #include "util/id_based_allocator.hpp"
 #include "util/alloc_ptr.hpp"
 #include "util/list.hpp"
+#include "util/bitset.hpp"
 #include "level/chunk.hpp"
 #include "level/light.hpp"
+#include "level/light_engine.hpp"
+#include "level/level_streamer.hpp"
 #include "levelgen/gen.hpp"
 #include "item/item_metadata.hpp"
 #include "item/util.hpp"
@@ -88,7 +91,7 @@ struct Level {
     ElasticPoolAllocator<sizeof(ItemMetadata) * 4, 256> item_metadata_allocator;
 
     [[SERIALIZE_IGNORE]]
-    PoolAllocator<sizeof(Chunk), 64> chunk_allocator;
+    ElasticPoolAllocator<sizeof(Chunk), 64> chunk_allocator;
 
     // universal allocator for all of the above types
     [[SERIALIZE_IGNORE]]
@@ -105,6 +108,42 @@ struct Level {
     // chunk data
     List<alloc_ptr<Chunk>> chunks;
 
+    // all chunks which are currently present in "chunks"
+    [[SERIALIZE_IGNORE]]
+    std::vector<Chunk*> loaded_chunks;
+
+    // present if chunks are streamed in/out, see level_streamer.hpp
+    std::optional<LevelStreamer> streamer;
+
+    // ids of entities which are paged out to disk along with their chunk,
+    // reserved until they are paged back in. rebuilt from streamer on load.
+    [[SERIALIZE_IGNORE]]
+    Bitset<MAX_ENTITIES> paged_entities;
+
+    // state of current edit transaction, see begin_edit()
+    struct Edit {
+        // nesting depth of begin_edit() calls, 0 if not in a transaction
+        usize depth = 0;
+
+        // deferred Light::update positions
+        std::vector<ivec3> light_updates;
+
+        // deferred Light::remove (position, previous light value) nodes
+        std::vector<std::tuple<ivec3, u8>> light_removals;
+
+        // deferred Light::add (position, light value, number of removals
+        // queued before it) nodes. an addition is dropped at commit if its
+        // position is removed again later in the same transaction.
+        std::vector<std::tuple<ivec3, u8, usize>> light_additions;
+    };
+
+    [[SERIALIZE_IGNORE]]
+    Edit edit;
+
+    // propagates all light changes, keeps its queues between uses
+    [[SERIALIZE_IGNORE]]
+    LightEngine light_engine;
+
     // list of entities
     // SERIALIZE_IGNORE'd because entities are de/serialized manually in Chunk
     [[SERIALIZE_IGNORE]]
@@ -122,6 +161,14 @@ struct Level {
         const ivec2 &size,
         std::function<void(Level&)> &&generate);
 
+    // creates a streaming level, initially without any chunks. chunks are
+    // loaded/generated by streamer as they are needed.
+    Level(
+        Allocator *allocator,
+        usize depth,
+        const ivec2 &size,
+        LevelStreamer &&streamer);
+
     Level() = default;
     Level(const Level &other) = delete;
     Level(Level &&other) = default;
@@ -140,7 +187,9 @@ struct Level {
             if (id == 0) {
                 id++;
             }
-        } while (this->all_entities[id] && id != start);
+        } while (
+            (this->all_entities[id] || this->paged_entities[id])
+                && id != start);
 
         if (id == start) {
             WARN("out of entity IDs");
@@ -174,6 +223,33 @@ struct Level {
 
     void tick();
 
+    // begins an edit transaction. until the matching commit_edit(), tile
+    // writes still take effect immediately but lighting and chunk version
+    // bumps are deferred and applied in one batch on commit. transactions
+    // may be nested, only the outermost commit applies the batch.
+    void begin_edit();
+
+    // commits the current edit transaction, see begin_edit()
+    void commit_edit();
+
+    // true if the level is in an edit transaction
+    inline bool in_edit() const {
+        return this->edit.depth != 0;
+    }
+
+    // adds a chunk to the level at its offset, which must be empty. if
+    // reconcile, reconcile_borders() is run for it, otherwise the caller must
+    // do so once the chunk is ready (e.g. resolved after paging in)
+    Chunk &place_chunk(alloc_ptr<Chunk> &&chunk, bool reconcile = true);
+
+    // removes the chunk at offset from the level, returning it. its former
+    // neighbors are reconciled, see reconcile_borders()
+    alloc_ptr<Chunk> remove_chunk(const ivec2 &offset);
+
+    // the chunk at offset was just placed or removed: remesh its neighbors
+    // along the shared borders and reconcile light across them
+    void reconcile_borders(const ivec2 &offset);
+
     // loads an already allocated entity into this level
     template <typename E>
     IEntityRef<E> load(alloc_ptr<E> &&e) {
@@ -279,6 +355,32 @@ struct Level {
     // find topmost tile at xz column
     std::optional<std::tuple<usize, TileId>> topmost_tile(const ivec2 &xz);
 
+    // height of column at xz: one above the Y of its topmost non-air tile, 0
+    // if the column is empty or not loaded
+    inline usize height(const ivec2 &xz) const {
+        if (xz.x < 0 || xz.y < 0) {
+            return 0;
+        }
+
+        const auto *chunk = this->chunkp(Level::to_offset(xz));
+        return chunk ?
+            chunk->height(Level::to_chunk_pos(ivec3(xz.x, 0, xz.y)).xz())
+            : 0;
+    }
+
+    // like height(), but for the topmost solid tile
+    inline usize height_solid(const ivec2 &xz) const {
+        if (xz.x < 0 || xz.y < 0) {
+            return 0;
+        }
+
+        const auto *chunk = this->chunkp(Level::to_offset(xz));
+        return chunk ?
+            chunk->height_solid(
+                Level::to_chunk_pos(ivec3(xz.x, 0, xz.y)).xz())
+            : 0;
+    }
+
     // returns true if the tile at the specified position is possibly visible
     bool visible(const ivec3 &pos) const;
 
@@ -292,6 +394,136 @@ struct Level {
         EntityRef entity,
         ItemRef item);
 
+    // runs f(const ivec3 &pos, Chunk &chunk, u16 index) for every loaded
+    // position in area (inclusive), where index is the index of pos in
+    // chunk's data (see Chunk::Offset). each intersecting chunk is looked up
+    // once and walked directly, prefer over per-position LevelDataAccess.
+    // chunks for which filter(const Chunk &chunk) is false are skipped whole.
+    template <typename F>
+    void for_each(const AABBi &area, F &&f) const {
+        this->for_each(area, std::forward<F>(f), [](const Chunk&) {
+            return true;
+        });
+    }
+
+    template <typename F, typename G>
+    void for_each(const AABBi &area, F &&f, G &&filter) const {
+        const auto
+            min = math::max(area.min, ivec3(0)),
+            max = math::min(
+                area.max,
+                ivec3(
+                    std::numeric_limits<i32>::max(),
+                    Chunk::SIZE.y - 1,
+                    std::numeric_limits<i32>::max()));
+
+        if (math::any(math::greaterThan(min, max))) {
+            return;
+        }
+
+        const auto
+            offset_min = Level::to_offset(min),
+            offset_max = Level::to_offset(max);
+
+        for (isize cx = offset_min.x; cx <= offset_max.x; cx++) {
+            for (isize cz = offset_min.y; cz <= offset_max.y; cz++) {
+                auto *chunk = this->chunkp(ivec2(cx, cz));
+                if (!chunk || !filter(*chunk)) {
+                    continue;
+                }
+
+                // area in chunk space
+                const auto
+                    min_c =
+                        math::max(min - chunk->offset_tiles, ivec3(0)),
+                    max_c =
+                        math::min(
+                            max - chunk->offset_tiles,
+                            Chunk::SIZE - 1);
+
+                for (isize x = min_c.x; x <= max_c.x; x++) {
+                    for (isize y = min_c.y; y <= max_c.y; y++) {
+                        isize index =
+                            (x * Chunk::STRIDE_X)
+                                + (y * Chunk::STRIDE_Y)
+                                + (min_c.z * Chunk::STRIDE_Z);
+
+                        for (isize z = min_c.z;
+                             z <= max_c.z;
+                             z++, index += Chunk::STRIDE_Z) {
+                            f(
+                                chunk->offset_tiles + ivec3(x, y, z),
+                                *chunk,
+                                static_cast<u16>(index));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // runs f(Direction::Enum d, const ivec3 &pos_n, Chunk &chunk, u16 index)
+    // for every loaded 6-connected neighbor pos_n of pos (see for_each()).
+    // neighbors within the same chunk as pos are resolved without lookups.
+    template <typename F>
+    void for_each_neighbor(const ivec3 &pos, F &&f) const {
+        Chunk *chunk = nullptr;
+        ivec3 pos_c = ivec3(0);
+        bool interior = false;
+
+        if (pos.x >= 0 && pos.z >= 0) {
+            chunk = this->chunkp(Level::to_offset(pos));
+            pos_c = Level::to_chunk_pos(pos);
+            interior =
+                chunk
+                    && pos_c.x > 0 && pos_c.x < Chunk::SIZE.x - 1
+                    && pos_c.z > 0 && pos_c.z < Chunk::SIZE.z - 1
+                    && pos_c.y >= 0 && pos_c.y < Chunk::SIZE.y;
+        }
+
+        const auto index =
+            (pos_c.x * Chunk::STRIDE_X)
+                + (pos_c.y * Chunk::STRIDE_Y)
+                + (pos_c.z * Chunk::STRIDE_Z);
+
+        for (const auto d : Direction::ALL) {
+            const auto dv = Direction::to_ivec3(d);
+            const auto pos_n = pos + dv;
+
+            if (pos_n.y < 0 || pos_n.y >= Chunk::SIZE.y) {
+                continue;
+            }
+
+            if (interior) {
+                f(
+                    d,
+                    pos_n,
+                    *chunk,
+                    static_cast<u16>(
+                        index
+                            + (dv.x * Chunk::STRIDE_X)
+                            + (dv.y * Chunk::STRIDE_Y)
+                            + (dv.z * Chunk::STRIDE_Z)));
+                continue;
+            }
+
+            if (!Level::in_bounds(pos_n)) {
+                continue;
+            }
+
+            auto *chunk_n = this->chunkp(Level::to_offset(pos_n));
+            if (!chunk_n) {
+                continue;
+            }
+
+            f(
+                d,
+                pos_n,
+                *chunk_n,
+                static_cast<u16>(Chunk::Offset(Level::to_chunk_pos(pos_n))));
+        }
+    }
+
     // AABB in tile space
     inline AABB2i aabb_tile() const {
         return AABB2i(ivec2(0), this->size * Chunk::SIZE.xz());
@@ -322,6 +554,13 @@ struct Level {
             : false;
     }
 
+    // returns true if the level contains the chunk at the specified offset
+    // but it is NOT loaded (streaming levels: paged out or not yet generated)
+    inline bool is_chunk_unloaded(const ivec2 &offset) const {
+        return this->to_index(offset) < this->chunks.size()
+            && !this->chunks[this->to_index(offset)];
+    }
+
     // returns true if the position is loaded in the level
     inline bool contains(const ivec3 &pos) const {
         return
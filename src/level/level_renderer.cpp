@@ -6,93 +6,123 @@
 #include "gfx/renderer.hpp"
 #include "gfx/game_camera.hpp"
 #include "gfx/render_context.hpp"
+#include "gfx/sun.hpp"
 #include "state/state_game.hpp"
+#include "occlusion_map.hpp"
 #include "constants.hpp"
 #include "global.hpp"
 
 void LevelRenderer::render() {
-    const auto bounds = global.game->camera->render_bounds();
+    const auto &camera = *global.game->camera;
+    const auto bounds = camera.render_bounds();
 
-    this->instanced_extras_renderers.clear();
+    // shadow casters for everything which the camera can see
+    const auto casters =
+        global.game->sun->casters(camera.frustum.aabb(), Chunk::SIZE.y);
 
-    // get rid of those that are no longer valid chunk renderers
+    // tiles which may contain casters
+    const auto bounds_s =
+        AABB2i(
+            ivec2(math::floor(casters.bounds.min.xz())),
+            ivec2(math::ceil(casters.bounds.max.xz())));
+
+    // chunks in bounds for each view, and in either
+    const auto to_offset =
+        [](ivec2 tile) {
+            return Level::to_offset(tile);
+        };
+    const auto
+        bounds_c = bounds.transform(to_offset),
+        bounds_cs = bounds_s.transform(to_offset),
+        bounds_r = AABB2i::merge(bounds_c, bounds_cs);
+
+    // renderers are kept for chunks just outside of bounds so that they are
+    // not remeshed as the camera jitters around chunk borders
+    const auto bounds_keep =
+        AABB2i(bounds_r.min - ivec2(1), bounds_r.max + ivec2(1));
+
+    // get rid of those that are no longer valid chunk renderers (chunk has
+    // been removed or replaced, i.e. by streaming) or are too far away
     for (auto it = this->chunk_renderers.begin();
          it != this->chunk_renderers.end();) {
-        auto &[offset, _] = *it;
+        auto &[offset, cr] = *it;
 
-        if (!this->level->contains_chunk(offset)) {
+        if (this->level->chunkp(offset) != &cr.chunk
+                || !bounds_keep.contains(offset)) {
+            this->mesher->cancel(cr.id);
             this->chunk_renderers.erase(it++);
         } else {
             it++;
         }
     }
 
-    // frustum cull entities
+    // apply finished meshes to their chunk renderers, results for renderers
+    // which have since been destroyed are dropped
+    this->mesher->poll(
+        [&](ChunkMesher::Result &result) {
+            const auto it = this->chunk_renderers.find(result.offset);
+            if (it != this->chunk_renderers.end()
+                    && it->second.id == result.id) {
+                it->second.apply(
+                    result.version, result.mask, result.sections);
+            }
+        });
+
+    for (auto *view : { &this->view_camera, &this->view_sun }) {
+        view->ctx =
+            global.frame_allocator.alloc<RenderContext>(
+                &global.frame_allocator);
+        view->extras.clear();
+        view->instanced_extras_renderers.clear();
+    }
+
+    // tiles in camera bounds
     const auto bounds_e =
         AABBi(
             ivec3(bounds.min.x, 0, bounds.min.y),
             ivec3(bounds.max.x, Chunk::SIZE.y, bounds.max.y));
-    const auto n_entities_alloc = this->level->num_entities(bounds_e);
+
+    // entities which may be in either view
+    const auto bounds_u = AABB2i::merge(bounds, bounds_s);
+    const auto bounds_er =
+        AABBi(
+            ivec3(bounds_u.min.x, 0, bounds_u.min.y),
+            ivec3(bounds_u.max.x, Chunk::SIZE.y, bounds_u.max.y));
+    const auto n_entities_alloc = this->level->num_entities(bounds_er);
 
     auto entities =
         global.frame_allocator.alloc_span<Entity*>(
             n_entities_alloc,
             Allocator::F_CALLOC);
-    const auto [_, overflow_e] =
-        this->level->entities(entities, bounds_e);
+    const auto [n_entities, overflow_e] =
+        this->level->entities(entities, bounds_er);
     ASSERT(!overflow_e);
 
-    // keep entities
-    this->frame_entities = entities;
-
-    // gather tiles with extras flag
-    auto tiles = global.frame_allocator.alloc_span<ivec3>(bounds_e.volume());
-    const auto [n_tiles, overflow_t] =
-        this->level->offsets_with_flags(
-            tiles, bounds_e, Chunk::TF_RENDER_EXTRAS);
-    ASSERT(!overflow_t);
-
-    // filter into visible tiles
-    auto tiles_visible =
-        global.frame_allocator.alloc_span<ivec3>(n_tiles);
-
-    usize n = 0;
-    for (const auto &pos : tiles.subspan(0, n_tiles)) {
-        if (global.game->camera->frustum
-                .contains(Level::to_tile_center(pos))
-                && this->level->visible(pos)) {
-            tiles_visible[n++] = pos;
-
-            // check if renderer has instanced extras which need to be
-            // renderered
-            const auto &tile = Tiles::get()[this->level->tiles[pos]];
-            const auto &renderer = tile.renderer();
-            if (renderer.has_instanced_extras()) {
-                this->instanced_extras_renderers.insert(&renderer);
-            }
-        }
+    // traverse entity renderers into the context of each view which they are
+    // in, culled by everything they render rather than their collision box
+    auto entities_in = entities.subspan(0, n_entities);
+    this->cull_boxes.clear();
+    for (const auto *e : entities_in) {
+        this->cull_boxes.push_back(e->render_aabb());
     }
+    this->cull(camera.frustum);
 
-    this->frame_extra_tiles = tiles_visible.subspan(0, n);
+    for (usize i = 0; i < entities_in.size(); i++) {
+        auto *e = entities_in[i];
 
-    // traverse entity renderers, construct context
-    this->frame_ctx =
-        global.frame_allocator.alloc<RenderContext>(
-            &global.frame_allocator);
+        if (this->cull_results[i]) {
+            e->render(*this->view_camera.ctx);
+        }
 
-    for (auto *e : this->frame_entities) {
-        e->render(*this->frame_ctx);
+        if (casters.contains(this->cull_boxes[i])) {
+            e->render(*this->view_sun.ctx);
+        }
     }
 
-    // render chunks in bounds
-    const auto bounds_c =
-        bounds.transform(
-            [](ivec2 tile) {
-                return Level::to_offset(tile);
-            });
-
-    for (isize x = bounds_c.min.x; x <= bounds_c.max.x; x++) {
-        for (isize z = bounds_c.min.y; z <= bounds_c.max.y; z++) {
+    // collect chunks in bounds of either view
+    this->frame_chunks.clear();
+    for (isize x = bounds_r.min.x; x <= bounds_r.max.x; x++) {
+        for (isize z = bounds_r.min.y; z <= bounds_r.max.y; z++) {
             ChunkRenderer *cr = nullptr;
             const auto offset = ivec2(x, z);
 
@@ -102,36 +132,176 @@ void LevelRenderer::render() {
             } else if (this->level->contains_chunk(offset)) {
                 auto &chunk = this->level->chunk(offset);
                 auto res = this->chunk_renderers.emplace(
-                    chunk.offset,
-                    ChunkRenderer(chunk));
+                    std::piecewise_construct,
+                    std::forward_as_tuple(chunk.offset),
+                    std::forward_as_tuple(chunk, *this->arena));
                 cr = &res.first->second;
             }
 
-            if (cr) {
-                cr->render(*this->frame_ctx);
+            if (!cr) {
+                continue;
+            }
+
+            // faces hidden by a neighbor are only uploaded near ghost tiles,
+            // a change is re-uploaded (not remeshed) by restore() below
+            cr->exposed =
+                global.game->occlusion_map->ghost_chunks.contains(offset);
+
+            // queue remesh if chunk has changed and is not already being
+            // meshed, ChunkRenderer::update() meshes synchronously otherwise
+            if (this->async_meshing
+                    && cr->chunk.render_version != 0
+                    && cr->needs_mesh()
+                    && cr->pending_version == 0) {
+                this->mesher->submit(*cr, cr->remesh_sections());
+            }
+
+            cr->update();
+            this->frame_chunks.push_back({ cr, bounds_c.contains(offset) });
+        }
+    }
+
+    // arena pools which grew while uploading were re-created empty, restore
+    // all geometry (along with that of chunks which entered or left ghost
+    // range). restoring can grow a pool again, so repeat until every renderer
+    // is up to date.
+    for (bool stale = true; stale;) {
+        stale = false;
+        for (auto &[_, cr] : this->chunk_renderers) {
+            if (cr.needs_restore()) {
+                cr.restore();
+                stale = true;
+            }
+        }
+    }
+
+    // cull sections of chunks in camera bounds against the camera frustum
+    // all at once, NUM_SECTIONS boxes per chunk
+    this->cull_boxes.clear();
+    for (auto &fc : this->frame_chunks) {
+        if (!fc.in_camera) {
+            continue;
+        }
+
+        const auto n = this->cull_boxes.size();
+        this->cull_boxes.resize(n + Chunk::NUM_SECTIONS);
+        fc.visible =
+            fc.cr->section_bounds(
+                std::span(this->cull_boxes)
+                    .subspan(n)
+                    .first<Chunk::NUM_SECTIONS>());
+    }
+    this->cull(camera.frustum);
+
+    usize n_sections = 0;
+    for (auto &fc : this->frame_chunks) {
+        if (!fc.in_camera) {
+            continue;
+        }
+
+        for (usize i = 0; i < Chunk::NUM_SECTIONS; i++) {
+            if (!this->cull_results[n_sections + i]) {
+                fc.visible &= ~(Chunk::SectionMask(1) << i);
+            }
+        }
+
+        n_sections += Chunk::NUM_SECTIONS;
+    }
+
+    // render chunks into each view, gather extras tiles
+    auto &extras_c = this->view_camera.extras;
+    this->cull_boxes.clear();
+
+    for (const auto &fc : this->frame_chunks) {
+        auto *cr = fc.cr;
+        const auto shadow =
+            cr->cull(
+                [&](const AABB &box) {
+                    return casters.contains(box);
+                });
+
+        cr->render(
+            *this->view_camera.ctx,
+            fc.visible,
+            RENDER_FLAG_PASS_BASE | RENDER_FLAG_PASS_TRANSPARENT);
+        cr->render(
+            *this->view_sun.ctx,
+            shadow,
+            RENDER_FLAG_PASS_SHADOW);
+
+        if (!fc.visible && !shadow) {
+            continue;
+        }
+
+        for (const auto &extra : cr->extras()) {
+            // camera extras are frustum culled by tile center below
+            if (fc.in_camera && bounds_e.contains(extra.pos)) {
+                const auto center = Level::to_tile_center(extra.pos);
+                extras_c.push_back({ cr, &extra });
+                this->cull_boxes.push_back(AABB(center, center));
+            }
+
+            // extras sit on top of their tile
+            if (casters.contains(
+                    AABB(
+                        vec3(extra.pos),
+                        vec3(extra.pos + ivec3(1, 2, 1))))) {
+                this->view_sun.extras.push_back({ cr, &extra });
             }
         }
     }
 
+    // drop camera extras outside of frustum, keeping order
+    this->cull(camera.frustum);
+    usize n_extras = 0;
+    for (usize i = 0; i < extras_c.size(); i++) {
+        if (this->cull_results[i]) {
+            extras_c[n_extras++] = extras_c[i];
+        }
+    }
+    extras_c.resize(n_extras);
 
-    // render_extras for all frame extras tiles
-    for (const auto &pos : this->frame_extra_tiles) {
-        const auto &tile = Tiles::get()[this->level->tiles[pos]];
-        tile.renderer().render_extras(
-            *this->frame_ctx,
-            this->level,
-            pos);
+    // views share instanced extras buffers, each is filled and flushed in
+    // turn
+    for (auto *view : { &this->view_camera, &this->view_sun }) {
+        this->render_extras(*view);
+        view->ctx->prepare();
     }
+}
 
-    // render instanced extras
-    for (const auto *r : this->instanced_extras_renderers) {
-        r->render_instanced_extras(*this->frame_ctx, this->level);
+void LevelRenderer::cull(const GameCamera::Frustum &frustum) {
+    this->cull_results.resize(this->cull_boxes.size());
+    frustum.cull(this->cull_boxes, this->cull_results);
+}
+
+void LevelRenderer::render_extras(View &view) {
+    for (const auto &[cr, extra] : view.extras) {
+        const auto *renderer = extra->renderer;
+        renderer->render_extras(*view.ctx, this->level, extra->pos);
+
+        // copy cached instances into the renderer's buffer for this view,
+        // they are rendered once per renderer after all tiles
+        if (renderer->has_instanced_extras()) {
+            view.instanced_extras_renderers.insert(renderer);
+
+            const auto &is = cr->instances.at(renderer);
+            if (extra->count != 0) {
+                renderer->instanced_extras_buffer()->push(
+                    std::span(is.data).subspan(extra->offset, extra->count),
+                    std::span(is.meshes).subspan(extra->offset, extra->count));
+            }
+        }
     }
 
-    this->frame_ctx->prepare();
+    for (const auto *r : view.instanced_extras_renderers) {
+        r->render_instanced_extras(*view.ctx, this->level);
+    }
 }
 
 void LevelRenderer::pass(RenderState render_state) {
-    // render everything in render context
-    this->frame_ctx->pass(render_state);
+    // each view only renders what was culled for it
+    auto &view =
+        (render_state.flags & RENDER_FLAG_PASS_SHADOW) ?
+            this->view_sun : this->view_camera;
+    view.ctx->pass(render_state);
 }
@@ -3,6 +3,9 @@
 #include "util/types.hpp"
 #include "util/util.hpp"
 #include "level/chunk_renderer.hpp"
+#include "level/chunk_mesher.hpp"
+#include "level/chunk_arena.hpp"
+#include "gfx/game_camera.hpp"
 
 struct Level;
 struct Entity;
@@ -12,20 +15,71 @@ struct RenderContext;
 struct LevelRenderer {
     Level *level;
 
+    // geometry of all chunk renderers. declared before chunk_renderers so
+    // that it outlives them, pointer so that LevelRenderer stays moveable.
+    std::unique_ptr<ChunkArena> arena;
+
     // TODO: more efficient storage
     std::unordered_map<ivec2, ChunkRenderer> chunk_renderers;
 
+    // if true, chunks are meshed asynchronously by mesher
+    bool async_meshing = true;
+
     explicit LevelRenderer(Level &level)
-        : level(&level) { }
+        : level(&level),
+          arena(std::make_unique<ChunkArena>()),
+          mesher(std::make_unique<ChunkMesher>()) { }
 
     void render();
 
     void pass(RenderState render_state);
 private:
-    RenderContext *frame_ctx = nullptr;
-    std::span<Entity*> frame_entities;
-    std::span<ivec3> frame_extra_tiles;
+    // a tile with extras, to be rendered in some view
+    struct ExtraRef {
+        const ChunkRenderer *cr;
+        const ChunkRenderer::Extra *extra;
+    };
 
-    // TODO: more efficient storage
-    std::unordered_set<const TileRenderer*> instanced_extras_renderers;
+    // per-view (camera, sun) render state. each view culls separately and
+    // walks only its own context in pass().
+    struct View {
+        RenderContext *ctx = nullptr;
+
+        // extras tiles in view, kept to avoid reallocating every frame
+        std::vector<ExtraRef> extras;
+
+        // TODO: more efficient storage
+        std::unordered_set<const TileRenderer*> instanced_extras_renderers;
+    };
+
+    // a chunk in bounds of either view this frame
+    struct FrameChunk {
+        ChunkRenderer *cr;
+
+        // true if in camera bounds
+        bool in_camera;
+
+        // sections visible to the camera
+        Chunk::SectionMask visible = 0;
+    };
+
+    // renders extras tiles of view into its context
+    void render_extras(View &view);
+
+    // batch culls cull_boxes against frustum into cull_results
+    void cull(const GameCamera::Frustum &frustum);
+
+    // camera view, for all passes other than RENDER_FLAG_PASS_SHADOW
+    View view_camera;
+
+    // sun view, for RENDER_FLAG_PASS_SHADOW
+    View view_sun;
+
+    // per-frame storage, kept to avoid reallocating every frame
+    std::vector<FrameChunk> frame_chunks;
+    std::vector<AABB> cull_boxes;
+    std::vector<u8> cull_results;
+
+    // NOTE: pointer so that LevelRenderer stays moveable
+    std::unique_ptr<ChunkMesher> mesher;
 };
@@ -0,0 +1,296 @@
+#include "level/level_streamer.hpp"
+#include "level/level.hpp"
+#include "level/chunk.hpp"
+#include "entity/entity.hpp"
+#include "serialize/serialize.hpp"
+#include "serialize/context_level.hpp"
+#include "util/file.hpp"
+#include "global.hpp"
+
+SERIALIZE_ENABLE()
+DECL_SERIALIZER_OPT(LevelStreamer)
+DECL_SERIALIZER(LevelStreamer::Page)
+DECL_PRIMITIVE_SERIALIZER(std::vector<LevelStreamer::Page>)
+
+LevelStreamer::LevelStreamer(
+    const std::string &path,
+    GenerateFn &&generate,
+    usize radius_load,
+    usize radius_unload)
+    : path(path),
+      generate(std::move(generate)),
+      radius_load(radius_load),
+      radius_unload(radius_unload) {
+    // LevelRenderer keeps chunk renderers around for chunks one chunk outside
+    // of the render bounds, evicted chunks must be outside of that
+    ASSERT(
+        radius_unload > radius_load && radius_unload >= 2,
+        "invalid streaming radii {}/{}",
+        radius_load,
+        radius_unload);
+
+    // nothing is paged out yet, files left over from some other level are
+    // stale
+    std::filesystem::create_directories(this->path);
+    this->clear_files();
+}
+
+std::string LevelStreamer::chunk_path(const ivec2 &offset) const {
+    return fmt::format("{}/chunk_{}_{}.dat", this->path, offset.x, offset.y);
+}
+
+const LevelStreamer::Page *LevelStreamer::page(const ivec2 &offset) const {
+    const auto it =
+        std::find_if(
+            this->pages.begin(),
+            this->pages.end(),
+            [&](const Page &p) { return p.offset == offset; });
+    return it == this->pages.end() ? nullptr : &*it;
+}
+
+std::vector<ivec2> LevelStreamer::missing(
+    const Level &level,
+    const AABB2i &area) const {
+    const auto area_c =
+        AABB2i(
+            Level::to_offset(area.min),
+            Level::to_offset(area.max));
+
+    const auto bounds_load =
+        AABB2i(
+            area_c.min - ivec2(this->radius_load),
+            area_c.max + ivec2(this->radius_load))
+            .clamp(level.aabb_chunk());
+
+    std::vector<ivec2> result;
+    for (isize x = bounds_load.min.x; x <= bounds_load.max.x; x++) {
+        for (isize z = bounds_load.min.y; z <= bounds_load.max.y; z++) {
+            const auto offset = ivec2(x, z);
+            if (!level.contains_chunk(offset)) {
+                result.push_back(offset);
+            }
+        }
+    }
+
+    const auto center = area_c.center();
+    std::sort(
+        result.begin(),
+        result.end(),
+        [&](const ivec2 &a, const ivec2 &b) {
+            return math::dot(a - center, a - center)
+                < math::dot(b - center, b - center);
+        });
+
+    return result;
+}
+
+void LevelStreamer::update(Level &level, const AABB2i &area) {
+    const auto area_c =
+        AABB2i(
+            Level::to_offset(area.min),
+            Level::to_offset(area.max));
+
+    // evict chunks which are out of range
+    const auto bounds_unload =
+        AABB2i(
+            area_c.min - ivec2(this->radius_unload),
+            area_c.max + ivec2(this->radius_unload));
+
+    // copy as list is modified by evict()
+    const auto loaded = level.loaded_chunks;
+    for (const auto *chunk : loaded) {
+        if (!bounds_unload.contains(chunk->offset)) {
+            this->evict(level, chunk->offset);
+        }
+    }
+
+    // load chunks which are in range, closest to the area center first
+    const auto missing = this->missing(level, area);
+    for (usize i = 0;
+         i < math::min(missing.size(), this->max_loads_per_update);
+         i++) {
+        this->load(level, missing[i]);
+    }
+}
+
+void LevelStreamer::load_all(Level &level, const AABB2i &area) {
+    for (const auto &offset : this->missing(level, area)) {
+        this->load(level, offset);
+    }
+}
+
+Chunk *LevelStreamer::load(Level &level, const ivec2 &offset) {
+    if (level.to_index(offset) >= level.chunks.size()) {
+        return nullptr;
+    }
+
+    ASSERT(!level.contains_chunk(offset));
+
+    auto it =
+        std::find_if(
+            this->pages.begin(),
+            this->pages.end(),
+            [&](const Page &p) { return p.offset == offset; });
+
+    const auto path = this->chunk_path(offset);
+
+    std::vector<u8> data;
+    if (it != this->pages.end()) {
+        auto res = file::read_file(path);
+
+        if (res.isErr()) {
+            // page is lost along with its entities, generate the chunk again
+            WARN(
+                "could not page in chunk {}, regenerating: {}",
+                offset,
+                res.unwrapErr());
+
+            for (const auto id : it->entities) {
+                level.paged_entities.clear(id);
+            }
+
+            this->pages.erase(it);
+            it = this->pages.end();
+        } else {
+            data = res.unwrap();
+        }
+    }
+
+    if (it == this->pages.end()) {
+        auto &chunk =
+            level.place_chunk(
+                make_alloc_ptr<Chunk>(level.chunk_allocator, level, offset));
+
+        if (this->generate) {
+            level.begin_edit();
+            this->generate(level, chunk);
+            level.commit_edit();
+        }
+
+        return &chunk;
+    }
+
+    // page in from disk
+    SerializationContextLevel ctx;
+    ctx.base_allocator = &global.allocator;
+    ctx.level = &level;
+
+    Archive archive(std::span { data });
+
+    alloc_ptr<Chunk> ptr;
+    Serializer<alloc_ptr<Chunk>>().deserialize(ptr, archive, ctx);
+    ASSERT(ptr && ptr->offset == offset);
+
+    // chunk must be present in level before resolving so its entities can be
+    // added back into it
+    auto &chunk = level.place_chunk(std::move(ptr), false);
+    ctx.resolve();
+    level.reconcile_borders(offset);
+
+    for (const auto id : it->entities) {
+        level.paged_entities.clear(id);
+    }
+
+    this->pages.erase(it);
+    std::filesystem::remove(path);
+    return &chunk;
+}
+
+void LevelStreamer::evict(Level &level, const ivec2 &offset) {
+    auto *chunk = level.chunkp(offset);
+    ASSERT(chunk);
+
+    SerializationContextLevel ctx;
+    ctx.base_allocator = &global.allocator;
+    ctx.level = &level;
+
+    // chunk serializes its own entities
+    ElasticArchive archive(64 * 1024);
+    Serializer<alloc_ptr<Chunk>>()
+        .serialize(level.chunks[level.to_index(offset)], archive, ctx);
+
+    const auto res =
+        file::write_file(
+            this->chunk_path(offset),
+            archive.buffer().subspan(0, archive.position()));
+
+    if (res.isErr()) {
+        WARN("could not page out chunk {}: {}", offset, res.unwrapErr());
+        return;
+    }
+
+    // remove entities from level without destroying them, reserving their ids
+    // until they are paged back in
+    const auto entities =
+        std::vector<Entity*>(chunk->entities.begin(), chunk->entities.end());
+
+    auto &page = this->pages.emplace_back(Page { offset, { }, { } });
+
+    for (auto *e : entities) {
+        const auto id = e->id;
+        e->detach();
+        page.entities.push_back(id);
+        level.paged_entities.set(id);
+        level.all_entities[id].clear();
+    }
+
+    level.remove_chunk(offset);
+}
+
+void LevelStreamer::clear_files() const {
+    const auto files = file::list_files(this->path);
+    if (files.isErr()) {
+        return;
+    }
+
+    for (const auto &f : files.unwrap()) {
+        const auto name = std::filesystem::path(f).filename().string();
+        if (name.starts_with("chunk_") && name.ends_with(".dat")) {
+            std::filesystem::remove(f);
+        }
+    }
+}
+
+void LevelStreamer::on_before_serialize(SerializationContextLevel &ctx) {
+    for (auto &page : this->pages) {
+        auto data = file::read_file(this->chunk_path(page.offset));
+
+        if (data.isErr()) {
+            // save would be missing this chunk, fail it rather than the game
+            ctx.fail(
+                fmt::format(
+                    "could not read paged out chunk {}: {}",
+                    page.offset,
+                    data.unwrapErr()));
+            page.data.clear();
+            continue;
+        }
+
+        page.data = data.unwrap();
+    }
+}
+
+void LevelStreamer::on_after_serialize(SerializationContext &ctx) {
+    for (auto &page : this->pages) {
+        page.data.clear();
+        page.data.shrink_to_fit();
+    }
+}
+
+void LevelStreamer::on_after_deserialize(SerializationContext &ctx) {
+    std::filesystem::create_directories(this->path);
+    this->clear_files();
+
+    for (auto &page : this->pages) {
+        const auto res =
+            file::write_file(this->chunk_path(page.offset), page.data);
+        ASSERT(
+            !res.isErr(),
+            "could not restore paged out chunk {}: {}",
+            page.offset,
+            res.unwrapErr());
+
+        page.data.clear();
+        page.data.shrink_to_fit();
+    }
+}
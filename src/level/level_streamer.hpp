@@ -0,0 +1,111 @@
+#pragma once
+
+#include "util/types.hpp"
+#include "util/util.hpp"
+#include "util/math.hpp"
+#include "util/aabb.hpp"
+#include "serialize/annotations.hpp"
+#include "entity/util.hpp"
+
+struct Level;
+struct Chunk;
+struct SerializationContext;
+struct SerializationContextLevel;
+
+// streams chunks of a level in and out around an area of interest (usually
+// GameCamera::render_bounds()).
+//
+// chunks which come within radius_load chunks of the area are paged in from
+// disk if they were previously evicted or generated otherwise. chunks further
+// than radius_unload chunks away are paged out to disk (along with their
+// entities) and freed. keeping radius_unload > radius_load gives hysteresis so
+// that chunks on the edge are not thrashed as the camera moves.
+//
+// evicted chunks live in "path" while the level is running. they are copied
+// into saves of the level (see on_before_serialize) and written back out when
+// a save is loaded, so a save always contains every chunk.
+struct LevelStreamer {
+    using GenerateFn = std::function<void(Level&, Chunk&)>;
+
+    // a chunk which is paged out to disk
+    struct Page {
+        ivec2 offset;
+
+        // ids of entities paged out with the chunk, reserved until it is
+        // paged back in
+        std::vector<EntityId> entities;
+
+        // contents of chunk_path(offset), only present while the level is
+        // being saved or loaded
+        std::vector<u8> data;
+    };
+
+    // default radii, in chunks
+    static constexpr usize
+        DEFAULT_RADIUS_LOAD = 1,
+        DEFAULT_RADIUS_UNLOAD = 3;
+
+    // maximum number of chunks paged in/generated per update() so that
+    // sudden camera moves are spread out over multiple ticks
+    static constexpr usize DEFAULT_MAX_LOADS_PER_UPDATE = 2;
+
+    // directory which paged out chunks are written to
+    std::string path;
+
+    // called on new chunks which have never been loaded before. not saved,
+    // must be set again after a level is loaded.
+    [[SERIALIZE_IGNORE]]
+    GenerateFn generate;
+
+    // all chunks which are currently paged out
+    std::vector<Page> pages;
+
+    usize radius_load = DEFAULT_RADIUS_LOAD;
+    usize radius_unload = DEFAULT_RADIUS_UNLOAD;
+    usize max_loads_per_update = DEFAULT_MAX_LOADS_PER_UPDATE;
+
+    LevelStreamer() = default;
+    LevelStreamer(
+        const std::string &path,
+        GenerateFn &&generate,
+        usize radius_load = DEFAULT_RADIUS_LOAD,
+        usize radius_unload = DEFAULT_RADIUS_UNLOAD);
+
+    // load and evict chunks around the specified area (in tile space)
+    void update(Level &level, const AABB2i &area);
+
+    // loads all chunks in range of area (in tile space) at once, ignoring
+    // max_loads_per_update. use before placing anything in a new area.
+    void load_all(Level &level, const AABB2i &area);
+
+    // loads chunk at offset into level, either from disk or by generating it.
+    // returns the loaded chunk, nullptr if the offset is outside of the level.
+    Chunk *load(Level &level, const ivec2 &offset);
+
+    // pages chunk at offset (and all of its entities) out to disk, removing it
+    // from the level
+    void evict(Level &level, const ivec2 &offset);
+
+    // file which chunk at the specified offset is paged out to
+    std::string chunk_path(const ivec2 &offset) const;
+
+    // page for chunk at offset, nullptr if it is not paged out
+    const Page *page(const ivec2 &offset) const;
+
+    // copies paged out chunks into pages so that they are saved, fails ctx if
+    // any cannot be read
+    void on_before_serialize(SerializationContextLevel &ctx);
+
+    void on_after_serialize(SerializationContext &ctx);
+
+    // writes saved pages back out to path, replacing whatever was there
+    void on_after_deserialize(SerializationContext &ctx);
+
+private:
+    // chunks in range of area (in tile space) which are not in level,
+    // closest to area first
+    std::vector<ivec2> missing(const Level &level, const AABB2i &area) const;
+
+    // removes all paged out chunk files from path
+    void clear_files() const;
+};
@@ -5,6 +5,7 @@
 #include "util/util.hpp"
 #include "util/math.hpp"
 #include "util/aabb.hpp"
+#include "constants.hpp"
 
 // forward declaration
 struct Level;
@@ -36,10 +37,43 @@ struct Light {
         return fmt::format("Light(pos={},color={})", this->pos, this->color);
     }
 
+    // distance at which attenuation falls below LIGHT_ATTENUATION_CUTOFF
+    inline f32 radius() const {
+        // solve quadratic * d^2 + linear * d + constant = 1 / cutoff
+        const auto c =
+            this->att_constant - (1.0f / f32(LIGHT_ATTENUATION_CUTOFF));
+
+        if (c >= 0.0f) {
+            return 0.0f;
+        } else if (this->att_quadratic <= 0.0f) {
+            return this->att_linear <= 0.0f ?
+                std::numeric_limits<f32>::max()
+                : (-c / this->att_linear);
+        }
+
+        return
+            (-this->att_linear
+                + math::sqrt(
+                    (this->att_linear * this->att_linear)
+                        - (4.0f * this->att_quadratic * c)))
+            / (2.0f * this->att_quadratic);
+    }
+
+    // NOTE: all propagation is done by Level::light_engine. add/remove/update
+    // are deferred until commit if level is in an edit transaction (see
+    // Level::begin_edit), where all removals are applied before additions
     static void add(Level &level, const ivec3 &pos, u8 light);
     static void remove(Level &level, const ivec3 &pos, u8 light);
     static void update(Level &level, const ivec3 &pos);
 
+    // remove many lights at once with a single removal/refill pass, nodes are
+    // (position, previous light value)
+    static void remove(
+        Level &level, std::span<const std::tuple<ivec3, u8>> nodes);
+
+    // re-propagate light into many positions at once
+    static void update(Level &level, std::span<const ivec3> positions);
+
     // uploads light uniforms for the program
     static void set_uniforms(
         const Program &program,
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "util/types.hpp"
+#include "util/util.hpp"
+#include "util/math.hpp"
+#include "util/assert.hpp"
+#include "util/ndarray.hpp"
+
+// chunked light propagation used by LightEngine::bake, kept header-only and
+// generic over chunk storage so that it can be tested without a level.
+//
+// a grid G is a set of equally sized chunks, each of which is only ever
+// written by the thread processing it:
+//   static constexpr ivec3 SIZE                  chunk size in tiles
+//   usize size() const                           number of chunks
+//   isize neighbor(usize c, const ivec2 &d) const
+//                                                chunk at XZ offset d from c,
+//                                                -1 if there is none
+//   std::tuple<u8, bool> read(usize c, const ivec3 &pos) const
+//                                                (light, transmits light)
+//   void write(usize c, const ivec3 &pos, u8 light)
+//   void clear(usize c)                          sets all light in c to 0
+//   bool dark(usize c) const                     true if c has no light to
+//                                                give its neighbors
+//   bool opaque(usize c) const                   true if no light can enter c
+namespace light_bake {
+// chunk space light node
+struct Node {
+    ivec3 pos;
+    u8 value;
+
+    Node() = default;
+    Node(const ivec3 &pos, u8 value) : pos(pos), value(value) {}
+};
+
+// flood light from nodes in queue (already written) through chunk c,
+// light which would cross the chunk border is left to bake()
+template <typename G>
+void propagate_chunk(G &grid, usize c, std::vector<Node> &queue) {
+    static constexpr std::array<ivec3, 6> OFFSETS = {
+        ivec3(1, 0, 0), ivec3(-1, 0, 0),
+        ivec3(0, 1, 0), ivec3(0, -1, 0),
+        ivec3(0, 0, 1), ivec3(0, 0, -1)
+    };
+
+    // FIFO so that higher light values are always set first
+    for (usize head = 0; head < queue.size(); head++) {
+        const auto [pos, light] = queue[head];
+
+        if (light <= 1) {
+            continue;
+        }
+
+        for (const auto &o : OFFSETS) {
+            const auto pos_n = pos + o;
+            if (!ndarray::in_bounds(G::SIZE, pos_n)) {
+                continue;
+            }
+
+            const auto [light_n, transmits_n] = grid.read(c, pos_n);
+            const u8 new_light_n = light - 1;
+
+            if (light_n >= new_light_n || !transmits_n) {
+                continue;
+            }
+
+            grid.write(c, pos_n, new_light_n);
+
+            if (new_light_n > 1) {
+                queue.emplace_back(pos_n, new_light_n);
+            }
+        }
+    }
+
+    queue.clear();
+}
+
+// apply seeds to chunk c and propagate them, returns true if any light
+// value changed
+template <typename G>
+bool seed_chunk(G &grid, usize c, std::span<const Node> seeds) {
+    static thread_local std::vector<Node> queue;
+
+    for (const auto &n : seeds) {
+        const auto [light, _] = grid.read(c, n.pos);
+        if (light >= n.value) {
+            continue;
+        }
+
+        grid.write(c, n.pos, n.value);
+        queue.push_back(n);
+    }
+
+    const auto changed = !queue.empty();
+    propagate_chunk(grid, c, queue);
+    return changed;
+}
+
+// recompute all light in grid from seeds, where seeds[c] are the light
+// emitters of chunk c. chunks are propagated independently on worker
+// threads and then reconciled across chunk borders in rounds until nothing
+// changes. the result is the same as that of a single flood fill over the
+// whole grid, as both converge to the maximum over all paths.
+// NOTE: seeds is used as scratch space and is clobbered
+template <typename G>
+void bake(G &grid, std::vector<std::vector<Node>> &seeds) {
+    static constexpr std::array<ivec2, 4> CARDINAL = {
+        ivec2(1, 0), ivec2(-1, 0), ivec2(0, 1), ivec2(0, -1)
+    };
+
+    const auto n = grid.size();
+    ASSERT(seeds.size() == n);
+
+#pragma omp parallel for schedule(dynamic)
+    for (usize c = 0; c < n; c++) {
+        grid.clear(c);
+        seed_chunk(grid, c, seeds[c]);
+    }
+
+    // light on one side of a chunk border seeds the other side. seeds for
+    // every chunk are gathered (read only) before any are propagated
+    // (write only to own chunk) so that threads never race on neighboring
+    // chunks.
+    bool changed = true;
+    while (changed) {
+#pragma omp parallel for schedule(dynamic)
+        for (usize c = 0; c < n; c++) {
+            auto &nodes = seeds[c];
+            nodes.clear();
+
+            if (grid.opaque(c)) {
+                continue;
+            }
+
+            for (const auto &d : CARDINAL) {
+                const auto c_n = grid.neighbor(c, d);
+                if (c_n < 0 || grid.dark(c_n)) {
+                    continue;
+                }
+
+                // border layer of this chunk facing d
+                const auto axis = d.x != 0 ? 0 : 2;
+                const auto border =
+                    (d.x + d.y) > 0 ? (G::SIZE[axis] - 1) : 0;
+
+                for (isize y = 0; y < G::SIZE.y; y++) {
+                    for (isize a = 0; a < G::SIZE[2 - axis]; a++) {
+                        ivec3 pos(0, y, 0);
+                        pos[axis] = border;
+                        pos[2 - axis] = a;
+
+                        // matching tile across the border
+                        auto pos_n = pos;
+                        pos_n[axis] = (G::SIZE[axis] - 1) - border;
+
+                        const auto [light_n, _] = grid.read(c_n, pos_n);
+                        if (light_n <= 1) {
+                            continue;
+                        }
+
+                        const auto [light, transmits] = grid.read(c, pos);
+                        if (light < light_n - 1 && transmits) {
+                            nodes.emplace_back(pos, light_n - 1);
+                        }
+                    }
+                }
+            }
+        }
+
+        changed = false;
+
+#pragma omp parallel for schedule(dynamic) reduction(||:changed)
+        for (usize c = 0; c < n; c++) {
+            changed = seed_chunk(grid, c, seeds[c]) || changed;
+        }
+    }
+}
+}
@@ -0,0 +1,59 @@
+#include "level/light_clusters.hpp"
+#include "gfx/program.hpp"
+#include "gfx/renderer_resource.hpp"
+#include "global.hpp"
+
+// cell (offset, count) pairs are packed two per vec4, indices four per vec4
+static constexpr usize
+    CELLS_PER_VEC4 = 2,
+    INDICES_PER_VEC4 = 4;
+
+using ClusterBufferType = RDResource<bgfx::DynamicIndexBufferHandle>;
+static auto cluster_buffer =
+    RendererResource<ClusterBufferType>(
+        []() {
+            constexpr auto size =
+                ((LightClusters::MAX_CELLS / CELLS_PER_VEC4)
+                    + (LightClusters::MAX_INDICES / INDICES_PER_VEC4))
+                    * sizeof(vec4);
+            return gfx::as_bgfx_resource(
+                bgfx::createDynamicIndexBuffer(
+                    size / sizeof(u16), BGFX_BUFFER_COMPUTE_READ));
+        });
+
+void LightClusters::set_uniforms(const Program &program) const {
+    const auto
+        n_cells =
+            (this->cells.size() + (CELLS_PER_VEC4 - 1)) / CELLS_PER_VEC4,
+        n_indices =
+            (this->indices.size() + (INDICES_PER_VEC4 - 1))
+                / INDICES_PER_VEC4;
+
+    const auto data =
+        global.frame_allocator.alloc_span<vec4>(
+            math::max<usize>(n_cells + n_indices, 1),
+            Allocator::F_CALLOC);
+
+    for (usize i = 0; i < this->cells.size(); i++) {
+        auto &v = data[i / CELLS_PER_VEC4];
+        const auto j = (i % CELLS_PER_VEC4) * 2;
+        v[j + 0] = f32(this->cells[i].offset);
+        v[j + 1] = f32(this->cells[i].count);
+    }
+
+    for (usize i = 0; i < this->indices.size(); i++) {
+        data[n_cells + (i / INDICES_PER_VEC4)][i % INDICES_PER_VEC4] =
+            f32(this->indices[i]);
+    }
+
+    const auto &buffer = cluster_buffer.get();
+    bgfx::update(
+        buffer, 0, bgfx::makeRef(&data[0], data.size_bytes()));
+    bgfx::setBuffer(BUFFER_INDEX_LIGHT_CLUSTERS, buffer, bgfx::Access::Read);
+
+    std::array<vec4, 2> grid = {
+        vec4(this->area.min.x, this->area.min.y, this->cell_size, 0.0f),
+        vec4(this->dims.x, this->dims.y, n_cells, 0.0f)
+    };
+    program.try_set("u_light_grid", static_cast<void*>(&grid[0]), 2);
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "util/types.hpp"
+#include "util/util.hpp"
+#include "util/math.hpp"
+#include "util/aabb.hpp"
+#include "level/light.hpp"
+#include "constants.hpp"
+
+// forward declaration
+struct Program;
+
+// world space XZ grid over an area of the level, where each cell stores the
+// indices of all lights which can reach it. the light shader only loops over
+// the lights of the cell which a pixel is in, so the cost per pixel depends on
+// the local light density rather than the total number of lights.
+//
+// cells are stored compactly as (offset, count) into a single index list.
+struct LightClusters {
+    // default cell size, in tiles
+    static constexpr usize CELL_SIZE = 8;
+
+    // maximum number of cells, cell size grows past CELL_SIZE to stay under
+    static constexpr usize MAX_CELLS = 64 * 64;
+
+    // maximum number of lights in a cell, any more are dropped (furthest
+    // from the cell center first)
+    static constexpr usize MAX_PER_CELL = 64;
+
+    // maximum total number of light indices across all cells
+    static constexpr usize MAX_INDICES = 64 * 1024;
+
+    struct Cell {
+        u32 offset = 0, count = 0;
+    };
+
+    // tile area covered by the grid (inclusive)
+    AABB2i area;
+
+    // size of each cell, in tiles
+    usize cell_size = CELL_SIZE;
+
+    // number of cells on each axis
+    ivec2 dims = ivec2(0);
+
+    std::vector<Cell> cells;
+    std::vector<u16> indices;
+
+    LightClusters() = default;
+
+    // bins lights into cells of a grid over area. returns true on overflow,
+    // in which case the furthest lights were dropped from some cells.
+    bool build(std::span<const Light> lights, const AABB2i &area) {
+        ASSERT(lights.size() <= std::numeric_limits<u16>::max());
+
+        this->area = area;
+        const auto size = area.size() + ivec2(1);
+
+        this->cell_size = CELL_SIZE;
+        while (true) {
+            this->dims =
+                (size + ivec2(this->cell_size - 1)) / ivec2(this->cell_size);
+
+            if (usize(this->dims.x * this->dims.y) <= MAX_CELLS) {
+                break;
+            }
+
+            this->cell_size *= 2;
+        }
+
+        this->cells.assign(this->dims.x * this->dims.y, Cell());
+        this->indices.clear();
+
+        bool overflow = false;
+
+        // count, then prefix sum into offsets, then fill with every light
+        // which reaches each cell
+        for (const auto &l : lights) {
+            this->for_each_cell(l, [](Cell &c) { c.count++; });
+        }
+
+        u32 offset = 0;
+        for (auto &c : this->cells) {
+            c.offset = offset;
+            offset += c.count;
+            c.count = 0;
+        }
+
+        std::vector<u16> candidates(offset);
+        for (usize i = 0; i < lights.size(); i++) {
+            this->for_each_cell(
+                lights[i],
+                [&](Cell &c) { candidates[c.offset + c.count++] = i; });
+        }
+
+        // cells with too many lights keep those closest to their center.
+        // kept indices are packed in cell order.
+        for (usize j = 0; j < this->cells.size(); j++) {
+            auto &c = this->cells[j];
+            auto cell_lights =
+                std::span(candidates).subspan(c.offset, c.count);
+
+            if (cell_lights.size() > MAX_PER_CELL) {
+                const auto cell =
+                    ivec2(isize(j) % this->dims.x, isize(j) / this->dims.x);
+                const auto center =
+                    vec2(this->area.min + (cell * ivec2(this->cell_size)))
+                        + vec2(this->cell_size / 2.0f);
+
+                const auto dist =
+                    [&](u16 i) {
+                        const auto d = lights[i].pos.xz() - center;
+                        return math::dot(d, d);
+                    };
+
+                std::partial_sort(
+                    cell_lights.begin(),
+                    cell_lights.begin() + MAX_PER_CELL,
+                    cell_lights.end(),
+                    [&](u16 a, u16 b) { return dist(a) < dist(b); });
+
+                cell_lights = cell_lights.subspan(0, MAX_PER_CELL);
+                overflow = true;
+            }
+
+            if (this->indices.size() + cell_lights.size() > MAX_INDICES) {
+                cell_lights =
+                    cell_lights.subspan(
+                        0, MAX_INDICES - this->indices.size());
+                overflow = true;
+            }
+
+            c.offset = this->indices.size();
+            c.count = cell_lights.size();
+            this->indices.insert(
+                this->indices.end(), cell_lights.begin(), cell_lights.end());
+        }
+
+        return overflow;
+    }
+
+    // cell containing tile, clamped to grid
+    inline ivec2 to_cell(const ivec2 &tile) const {
+        return math::clamp(
+            (tile - this->area.min) / ivec2(this->cell_size),
+            ivec2(0),
+            this->dims - 1);
+    }
+
+    // indices of lights which may reach tile
+    inline std::span<const u16> lights(const ivec2 &tile) const {
+        if (this->cells.empty()) {
+            return {};
+        }
+
+        const auto c = this->to_cell(tile);
+        const auto &cell = this->cells[(c.y * this->dims.x) + c.x];
+        return std::span(this->indices).subspan(cell.offset, cell.count);
+    }
+
+    // uploads cluster buffer and grid uniforms for the program, see
+    // light/light.sc
+    void set_uniforms(const Program &program) const;
+
+private:
+    // calls f on every cell which light can reach
+    template <typename F>
+    inline void for_each_cell(const Light &light, F &&f) {
+        const auto r = light.radius();
+        const auto
+            min = math::floor(light.pos.xz() - vec2(r)),
+            max = math::ceil(light.pos.xz() + vec2(r));
+
+        // entirely outside of grid
+        if (max.x < this->area.min.x || max.y < this->area.min.y
+                || min.x > this->area.max.x || min.y > this->area.max.y) {
+            return;
+        }
+
+        // clamp before conversion, radius may be very large
+        const auto
+            c_min =
+                this->to_cell(
+                    ivec2(math::max(min, vec2(this->area.min)))),
+            c_max =
+                this->to_cell(
+                    ivec2(math::min(max, vec2(this->area.max))));
+
+        for (isize z = c_min.y; z <= c_max.y; z++) {
+            for (isize x = c_min.x; x <= c_max.x; x++) {
+                f(this->cells[(z * this->dims.x) + x]);
+            }
+        }
+    }
+};
@@ -0,0 +1,267 @@
+#include "level/light_engine.hpp"
+#include "level/level.hpp"
+#include "level/light_bake.hpp"
+
+// true if light can propagate into a tile with the specified data
+static inline bool transmits(Chunk::Data data) {
+    // try to avoid lookup into tile array if tile is air
+    const auto tile = Chunk::TileData::from(data);
+    return tile == 0
+        || Tiles::get()[tile].transparency_type() == Tile::Transparency::ON;
+}
+
+void LightEngine::add_propagate(Level &level) {
+    auto &queue = this->prop;
+
+    while (!queue.empty()) {
+        // NOTE: not a structured binding so that it can be captured
+        const auto node = queue.pop();
+        const auto light = node.value;
+
+        if (light <= 1) {
+            continue;
+        }
+
+        level.for_each_neighbor(
+            node.pos,
+            [&](Direction::Enum, const ivec3 &pos_n, Chunk &chunk, u16 i) {
+                const auto data_n = chunk.data.get(i);
+                const auto light_n = Chunk::LightData::from(data_n);
+                const u8 new_light_n = light - 1;
+
+                if (light_n >= new_light_n || !transmits(data_n)) {
+                    return;
+                }
+
+                auto proxy_n = chunk.raw[i];
+                Chunk::LightData::set_no_mesh(proxy_n, new_light_n);
+
+                if (new_light_n > 1) {
+                    queue.push({ pos_n, new_light_n });
+                }
+            });
+    }
+}
+
+void LightEngine::remove_propagate(Level &level) {
+    auto &queue = this->queue;
+    auto &prop = this->prop;
+
+    while (!queue.empty()) {
+        const auto node = queue.pop();
+        const auto light = node.value;
+
+        if (light == 0) {
+            continue;
+        }
+
+        level.for_each_neighbor(
+            node.pos,
+            [&](Direction::Enum, const ivec3 &pos_n, Chunk &chunk, u16 i) {
+                const auto light_n =
+                    Chunk::LightData::from(chunk.data.get(i));
+
+                if (light_n == 0) {
+                    return;
+                } else if (light_n < light) {
+                    auto proxy_n = chunk.raw[i];
+                    Chunk::LightData::set_no_mesh(proxy_n, 0);
+                    queue.push({ pos_n, light_n });
+                } else if (light_n >= light) {
+                    prop.push({ pos_n, light_n });
+                }
+            });
+    }
+}
+
+void LightEngine::add(
+    Level &level, std::span<const std::tuple<ivec3, u8>> sources) {
+    this->prop.clear();
+
+    for (const auto &[pos, light] : sources) {
+        if (!level.contains(pos)) {
+            continue;
+        }
+
+        level.light[pos] = light;
+        this->prop.push(Node(pos, light));
+    }
+
+    this->add_propagate(level);
+}
+
+void LightEngine::propagate(
+    Level &level,
+    std::span<const std::tuple<ivec3, u8>> removals,
+    std::span<const std::tuple<ivec3, u8>> additions,
+    std::span<const ivec3> updates) {
+    this->queue.clear();
+    this->prop.clear();
+
+    // clear all removed light first so that no refill can read a value which
+    // is about to be removed
+    for (const auto &[pos, light] : removals) {
+        if (!level.contains(pos)) {
+            continue;
+        }
+
+        level.light[pos] = 0;
+        this->queue.push(Node(pos, light));
+    }
+
+    this->remove_propagate(level);
+
+    // additions go after removals so that light re-added at a removed
+    // position is not cleared again
+    for (const auto &[pos, light] : additions) {
+        if (!level.contains(pos)) {
+            continue;
+        }
+
+        const u8 value = level.light[pos];
+        if (light > value) {
+            level.light[pos] = light;
+        }
+
+        this->prop.push(Node(pos, light));
+    }
+
+    // refill from the border of the removed area and from the neighbors of
+    // each updated position
+    for (const auto &pos : updates) {
+        for (const auto &d : Direction::ALL) {
+            const auto pos_n = pos + Direction::to_ivec3(d);
+            if (level.contains(pos_n)) {
+                this->prop.push(Node(pos_n, 0));
+            }
+        }
+    }
+
+    // light values may have changed after addition into the queue
+    for (auto &n : this->prop.pending()) {
+        n.value = level.light[n.pos];
+    }
+
+    this->add_propagate(level);
+}
+
+// light_bake grid over the loaded chunks of a level
+struct BakeGrid {
+    static constexpr auto SIZE = Chunk::SIZE;
+
+    const Level &level;
+
+    // level chunk index (see Level::to_index) -> index in loaded chunks
+    std::vector<isize> indices;
+
+    explicit BakeGrid(const Level &level)
+        : level(level),
+          indices(level.chunks.size(), -1) {
+        for (usize c = 0; c < level.loaded_chunks.size(); c++) {
+            this->indices[level.to_index(level.loaded_chunks[c]->offset)] = c;
+        }
+    }
+
+    inline usize size() const {
+        return this->level.loaded_chunks.size();
+    }
+
+    inline isize neighbor(usize c, const ivec2 &d) const {
+        const auto index =
+            this->level.to_index(this->level.loaded_chunks[c]->offset + d);
+        return index < this->indices.size() ? this->indices[index] : -1;
+    }
+
+    inline std::tuple<u8, bool> read(usize c, const ivec3 &pos) const {
+        const auto data =
+            this->level.loaded_chunks[c]->data.get(
+                static_cast<u16>(Chunk::Offset(pos)));
+        return { Chunk::LightData::from(data), transmits(data) };
+    }
+
+    inline void write(usize c, const ivec3 &pos, u8 light) {
+        auto proxy =
+            this->level.loaded_chunks[c]->raw[
+                static_cast<u16>(Chunk::Offset(pos))];
+        Chunk::LightData::set_no_mesh(proxy, light);
+    }
+
+    void clear(usize c) {
+        auto &chunk = *this->level.loaded_chunks[c];
+
+        // uniform chunk without light, e.g. all air in darkness
+        if (chunk.uniform()
+                && Chunk::LightData::from(chunk.data.get(0)) == 0) {
+            return;
+        }
+
+        for (usize i = 0; i < Chunk::VOLUME; i++) {
+            if (Chunk::LightData::from(chunk.data.get(i)) != 0) {
+                auto proxy = chunk.raw[static_cast<u16>(i)];
+                Chunk::LightData::set_no_mesh(proxy, 0);
+            }
+        }
+    }
+
+    inline bool dark(usize c) const {
+        const auto &chunk = *this->level.loaded_chunks[c];
+        return chunk.uniform()
+            && Chunk::LightData::from(chunk.data.get(0)) <= 1;
+    }
+
+    inline bool opaque(usize c) const {
+        const auto &chunk = *this->level.loaded_chunks[c];
+        return chunk.uniform() && !transmits(chunk.data.get(0));
+    }
+};
+
+u8 LightEngine::emission(Level &level, const Chunk &chunk, u16 index) {
+    const ivec3 pos = Chunk::Offset::from_raw(index);
+    const auto &tile =
+        Tiles::get()[Chunk::TileData::from(chunk.data.get(index))];
+
+    u8 value = 0;
+    for (const auto &l : tile.lights(level, chunk.offset_tiles + pos)) {
+        value = math::max(value, l.value);
+    }
+
+    return math::min(value, MAX_VALUE);
+}
+
+void LightEngine::bake(Level &level, bool parallel) {
+    const auto &chunks = level.loaded_chunks;
+
+    // gather (chunk space) seeds up front, Tile::lights is not necessarily
+    // safe to call from worker threads
+    std::vector<std::vector<light_bake::Node>> seeds(chunks.size());
+    for (usize c = 0; c < chunks.size(); c++) {
+        const auto &chunk = *chunks[c];
+
+        for (const auto index : chunk.emitters) {
+            if (const auto value = emission(level, chunk, index)) {
+                seeds[c].emplace_back(
+                    Chunk::Offset::from_raw(index), value);
+            }
+        }
+    }
+
+    auto grid = BakeGrid(level);
+
+    if (!parallel) {
+        for (usize c = 0; c < chunks.size(); c++) {
+            grid.clear(c);
+        }
+
+        std::vector<std::tuple<ivec3, u8>> sources;
+        for (usize c = 0; c < chunks.size(); c++) {
+            for (const auto &[pos, value] : seeds[c]) {
+                sources.emplace_back(chunks[c]->offset_tiles + pos, value);
+            }
+        }
+
+        this->add(level, sources);
+        return;
+    }
+
+    light_bake::bake(grid, seeds);
+}
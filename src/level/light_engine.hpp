@@ -0,0 +1,113 @@
+#pragma once
+
+#include "util/types.hpp"
+#include "util/util.hpp"
+#include "util/math.hpp"
+
+struct Level;
+struct Chunk;
+
+// propagates tile light values through a level.
+//
+// owned by Level so that its queues are allocated once and reused by every
+// light change instead of being rebuilt on each call. any number of removal
+// and addition seeds can be submitted to propagate(), which runs a single
+// removal pass over all of them followed by a single refill pass.
+struct LightEngine {
+    // maximum tile light value
+    static constexpr u8 MAX_VALUE = 15;
+
+    struct Node {
+        ivec3 pos;
+        u8 value;
+
+        Node() = default;
+        Node(const ivec3 &pos, u8 value) : pos(pos), value(value) {}
+    };
+
+    // FIFO queue of light nodes backed by a growable buffer, so it never
+    // overflows. storage is kept between uses.
+    // rationale for a queue over a stack (BFS over DFS) is that a queue will
+    // allow for higher lighting values to always be set first, therefore
+    // preventing the re-setting of lights over and over again under
+    // propagation
+    struct NodeQueue {
+        std::vector<Node> nodes;
+        usize head = 0;
+
+        inline usize size() const {
+            return this->nodes.size() - this->head;
+        }
+
+        inline bool empty() const {
+            return this->size() == 0;
+        }
+
+        inline void push(const Node &n) {
+            this->nodes.push_back(n);
+        }
+
+        inline Node pop() {
+            const auto n = this->nodes[this->head++];
+
+            // reset once drained so the buffer does not grow unboundedly
+            if (this->head == this->nodes.size()) {
+                this->clear();
+            }
+
+            return n;
+        }
+
+        // nodes which have not been popped yet
+        inline std::span<Node> pending() {
+            return std::span(this->nodes).subspan(this->head);
+        }
+
+        inline void clear() {
+            this->nodes.clear();
+            this->head = 0;
+        }
+    };
+
+    LightEngine() = default;
+    LightEngine(const LightEngine &other) = delete;
+    LightEngine(LightEngine &&other) = default;
+    LightEngine &operator=(const LightEngine &other) = delete;
+    LightEngine &operator=(LightEngine &&other) = default;
+
+    // sets light at each (position, value) in sources and propagates it
+    void add(Level &level, std::span<const std::tuple<ivec3, u8>> sources);
+
+    // removes light at each removal (position, previous light value), then
+    // sets light at each addition (position, value) and re-propagates light
+    // from each update position, all in one pass
+    void propagate(
+        Level &level,
+        std::span<const std::tuple<ivec3, u8>> removals,
+        std::span<const std::tuple<ivec3, u8>> additions,
+        std::span<const ivec3> updates);
+
+    // recomputes all light in the level from scratch, seeded by every light
+    // emitting tile (see Chunk::emitters). if parallel, chunks are propagated
+    // independently on worker threads and then reconciled across chunk borders
+    // (see light_bake::bake). the result is identical to that of a serial
+    // propagation from the same seeds, as both converge to the same (maximum
+    // over all paths) light values.
+    void bake(Level &level, bool parallel = true);
+
+    // light value emitted by the tile at data index of chunk, 0 if none
+    static u8 emission(Level &level, const Chunk &chunk, u16 index);
+
+    // total capacity of the queues in nodes, for debug
+    usize capacity() const {
+        return this->queue.nodes.capacity() + this->prop.nodes.capacity();
+    }
+
+private:
+    void add_propagate(Level &level);
+
+    void remove_propagate(Level &level);
+
+    // removal queue, then addition queue for remove_propagate()
+    NodeQueue queue, prop;
+};
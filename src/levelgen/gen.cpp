@@ -58,3 +58,22 @@ void DefaultLevelGenerator::generate(Level &level) {
         }
     }
 }
+
+void DefaultLevelGenerator::generate(Level &level, Chunk &chunk) {
+    // islands of grass on dirt, continuous across chunk borders
+    const auto noise = NoiseOctave(level.depth + 0x1234, 4, 0.0f);
+
+    for (isize x = 0; x < Chunk::SIZE.x; x++) {
+        for (isize z = 0; z < Chunk::SIZE.z; z++) {
+            const auto pos_l = chunk.offset_tiles.xz() + ivec2(x, z);
+
+            if (noise.sample(vec2(pos_l) * 0.05f) > 0.0f) {
+                // safe proxies so that tile flags/lighting are updated
+                chunk.tiles.safe(ivec3(x, 0, z)) =
+                    Tiles::get().get<TileDirt>();
+                chunk.tiles.safe(ivec3(x, 1, z)) =
+                    Tiles::get().get<TileGrass>();
+            }
+        }
+    }
+}
@@ -1,12 +1,18 @@
 #pragma once
 
 struct Level;
+struct Chunk;
 
 struct LevelGenerator {
     virtual ~LevelGenerator() = default;
     virtual void generate(Level &level) = 0;
+
+    // generate a single chunk, used for streaming levels (see LevelStreamer)
+    // where the level is not generated all at once
+    virtual void generate(Level &level, Chunk &chunk) {}
 };
 
 struct DefaultLevelGenerator : public LevelGenerator {
     void generate(Level &level) override;
+    void generate(Level &level, Chunk &chunk) override;
 };
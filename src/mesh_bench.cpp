@@ -0,0 +1,243 @@
+#include "level/level.hpp"
+#include "level/chunk_renderer.hpp"
+#include "level/chunk_neighborhood.hpp"
+#include "levelgen/gen.hpp"
+#include "tile/tile_stone.hpp"
+#include "util/noise.hpp"
+#include "util/time.hpp"
+#include "entry.hpp"
+#include "global.hpp"
+
+// headless benchmark of CPU chunk meshing (snapshot + custom + default tiles,
+// no GPU upload). run with --main mesh_bench [iterations].
+
+// size of benchmark levels, in chunks
+static constexpr auto LEVEL_SIZE = ivec2(8, 8);
+
+static constexpr usize DEFAULT_ITERATIONS = 8;
+
+struct BenchCase {
+    std::string name;
+    std::function<void(Level&)> generate;
+};
+
+// fills every position of level for which f(pos) is true with tile T. levels
+// generate in an edit transaction, so lighting is only baked once.
+template <typename T, typename F>
+static void fill(Level &level, F &&f) {
+    const auto aabb = level.aabb_tile();
+
+    ivec3 pos;
+    for (pos.x = aabb.min.x; pos.x < aabb.max.x; pos.x++) {
+        for (pos.z = aabb.min.y; pos.z < aabb.max.y; pos.z++) {
+            for (pos.y = 0; pos.y < Chunk::SIZE.y; pos.y++) {
+                if (f(pos)) {
+                    level.tiles[pos] = Tiles::get().get<T>();
+                }
+            }
+        }
+    }
+}
+
+static const auto CASES = std::array {
+    BenchCase {
+        "default",
+        [](Level &level) { DefaultLevelGenerator().generate(level); }
+    },
+    // worst case for drawn faces, every neighbor of a stone tile is air so
+    // every face is drawn and none can be merged
+    BenchCase {
+        "checkerboard",
+        [](Level &level) {
+            fill<TileStone>(
+                level,
+                [](const ivec3 &p) { return ((p.x + p.y + p.z) & 1) == 0; });
+        }
+    },
+    // best case for drawn faces, only faces on the top and bottom layers and
+    // on the level border are drawn. every other face is hidden by a
+    // neighbor, so this is the worst case for exposed faces.
+    BenchCase {
+        "all_stone",
+        [](Level &level) {
+            fill<TileStone>(level, [](const ivec3 &p) { return true; });
+        }
+    },
+    // stone with winding tunnels, 2D noise is shifted per layer so that caves
+    // are not straight columns
+    BenchCase {
+        "noise_caves",
+        [](Level &level) {
+            const auto noise = NoiseOctave(0x5EED, 4, 0.0f);
+            fill<TileStone>(
+                level,
+                [&](const ivec3 &p) {
+                    const auto q =
+                        (vec2(p.xz()) + vec2(p.y * 7.0f, p.y * -5.0f))
+                            * 0.08f;
+                    return math::abs(noise.sample(q)) > 0.15f;
+                });
+        }
+    }
+};
+
+// (name, greedy, format): current defaults, then each meshing optimization
+// turned off in turn
+using BenchConfig = std::tuple<std::string, bool, ChunkRenderer::Format>;
+static const auto CONFIGS =
+    std::array {
+        BenchConfig { "greedy/packed", true, ChunkRenderer::FORMAT_PACKED },
+        BenchConfig { "greedy/full", true, ChunkRenderer::FORMAT_FULL },
+        BenchConfig { "full", false, ChunkRenderer::FORMAT_FULL }
+    };
+
+// geometry totals of some passes
+struct BenchGeometry {
+    usize faces = 0, vertices = 0, bytes = 0;
+};
+
+struct BenchResult {
+    usize chunks = 0;
+
+    // drawn passes (PASS_DEFAULT, PASS_TRANSPARENT) and PASS_EXPOSED, which
+    // is only drawn near ghost tiles
+    BenchGeometry drawn, exposed;
+
+    // total time spent building neighborhoods
+    u64 snapshot_ns = 0;
+
+    // time to mesh each chunk, including its neighborhood
+    std::vector<u64> times;
+};
+
+static void count(
+    BenchResult &result,
+    std::span<const ChunkRenderer::Section> sections) {
+    const auto add =
+        [](BenchGeometry &g, const auto &b) {
+            g.faces += b.indices.size() / 6;
+            g.vertices += b.vertices.size();
+            g.bytes +=
+                (b.vertices.size() * sizeof(b.vertices[0]))
+                    + (b.indices.size() * sizeof(b.indices[0]));
+        };
+
+    for (const auto &s : sections) {
+        for (usize p = 0; p < ChunkRenderer::PASS_COUNT; p++) {
+            auto &g =
+                p == ChunkRenderer::PASS_EXPOSED ?
+                    result.exposed : result.drawn;
+            add(g, s.buffers[p]);
+            add(g, s.packed[p]);
+        }
+    }
+}
+
+static BenchResult run(Level &level, usize iterations) {
+    BenchResult result;
+
+    std::array<ChunkRenderer::Section, Chunk::NUM_SECTIONS> sections;
+    ChunkNeighborhood neighborhood;
+
+    // first iteration is a warmup (face table, allocations)
+    for (usize n = 0; n < iterations + 1; n++) {
+        for (auto *chunk : level.loaded_chunks) {
+            for (auto &s : sections) {
+                s.clear();
+            }
+
+            const auto start = global.time->now();
+            neighborhood.build(*chunk);
+            const auto built = global.time->now();
+            ChunkRenderer::mesh_custom(
+                *chunk, Chunk::ALL_SECTIONS, sections);
+            ChunkRenderer::mesh_default(
+                neighborhood, Chunk::ALL_SECTIONS, sections);
+            const auto end = global.time->now();
+
+            if (n == 0) {
+                continue;
+            }
+
+            result.chunks++;
+            result.snapshot_ns += built - start;
+            result.times.push_back(end - start);
+            count(result, sections);
+        }
+    }
+
+    return result;
+}
+
+static void report(const std::string &name, BenchResult &r) {
+    if (r.chunks == 0) {
+        LOG("{:<36} no chunks", name);
+        return;
+    }
+
+    std::sort(r.times.begin(), r.times.end());
+
+    u64 total = 0;
+    for (const auto t : r.times) {
+        total += t;
+    }
+
+    const auto percentile =
+        [&](f64 p) {
+            return Time::to_millis<f64>(
+                r.times[
+                    std::min<usize>(
+                        static_cast<usize>(p * r.times.size()),
+                        r.times.size() - 1)]);
+        };
+
+    // throughput counts every meshed face, per chunk sizes are split into
+    // what is drawn and what is only kept for ghosting
+    LOG(
+        "{:<36} {:>12.0f} faces/s"
+        " drawn {:>8} verts/chunk {:>9} bytes/chunk"
+        " exposed {:>8} verts/chunk {:>9} bytes/chunk"
+        " p50 {:.3f} ms p99 {:.3f} ms (snapshot {:.1f}%)",
+        name,
+        (r.drawn.faces + r.exposed.faces) / Time::to_seconds<f64>(total),
+        r.drawn.vertices / r.chunks,
+        r.drawn.bytes / r.chunks,
+        r.exposed.vertices / r.chunks,
+        r.exposed.bytes / r.chunks,
+        percentile(0.50),
+        percentile(0.99),
+        100.0 * (f64(r.snapshot_ns) / f64(total)));
+}
+
+int mesh_bench_main(int argc, char **argv) {
+    const usize iterations =
+        argc >= 4 ?
+            static_cast<usize>(std::max(std::atoi(argv[3]), 1))
+            : DEFAULT_ITERATIONS;
+
+    const auto greedy = ChunkRenderer::greedy;
+    const auto format = ChunkRenderer::format;
+
+    for (const auto &c : CASES) {
+        auto level =
+            std::make_unique<Level>(
+                &global.allocator,
+                0,
+                LEVEL_SIZE,
+                std::function<void(Level&)>(c.generate));
+
+        for (const auto &[config, g, f] : CONFIGS) {
+            ChunkRenderer::greedy = g;
+            ChunkRenderer::format = f;
+
+            auto result = run(*level, iterations);
+            report(fmt::format("{}/{}", c.name, config), result);
+        }
+    }
+
+    ChunkRenderer::greedy = greedy;
+    ChunkRenderer::format = format;
+    return 0;
+}
+
+DECL_ENTRY_POINT(mesh_bench, mesh_bench_main)
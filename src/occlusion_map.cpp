@@ -19,6 +19,7 @@ void OcclusionMap::init() {
     this->data_full = std::vector<u8>(math::prod(SIZE));
     this->data_top = std::vector<u8>(math::prod(SIZE.xz()));
     this->data_blocking = std::vector<u8>(math::prod(SIZE));
+    this->data_ghost = std::vector<u8>(math::prod(SIZE));
     this->texture_full =
         Texture(
             bgfx::createTexture3D(
@@ -52,6 +53,17 @@ void OcclusionMap::init() {
                 | BGFX_SAMPLER_U_CLAMP
                 | BGFX_SAMPLER_V_CLAMP),
             uvec2(0));
+    this->texture_ghost =
+        Texture(
+            bgfx::createTexture3D(
+                SIZE.x, SIZE.y, SIZE.z,
+                false,
+                bgfx::TextureFormat::R8,
+                BGFX_SAMPLER_MIN_POINT
+                | BGFX_SAMPLER_MAG_POINT
+                | BGFX_SAMPLER_U_CLAMP
+                | BGFX_SAMPLER_V_CLAMP),
+            uvec2(0));
 }
 
 static void compute_blocking(
@@ -62,11 +74,6 @@ static void compute_blocking(
     // scale applied to target AABB to stop rays
     constexpr auto TARGET_AABB_SCALE = 1.2f;
 
-    // returns true if position has tile and tile is solid
-    const auto is_solid =
-        [&](const ivec3 &pos) {
-            return Tiles::get()[level.tiles[pos]].solid(level, pos);
-        };
 
     std::fill(
         occlusion_map.data_blocking.begin(),
@@ -124,15 +131,27 @@ static void compute_blocking(
 
                     const auto pos_d = pos - occlusion_map.offset;
                     if (!AABBi(ivec3(OcclusionMap::SIZE) - 1)
-                            .contains(pos_d)
-                            || !is_solid(pos)) {
+                            .contains(pos_d)) {
+                        return hit_result;
+                    }
+
+                    // single lookup for both solidity and AABB checks
+                    const auto *chunk =
+                        level.chunkp(Level::to_offset(pos));
+                    if (!chunk) {
+                        return hit_result;
+                    }
+
+                    const auto &tile =
+                        Tiles::get()[
+                            Chunk::TileData::from(
+                                (*chunk)[Level::to_chunk_pos(pos)])];
+                    if (!tile.solid(level, pos)) {
                         return hit_result;
                     }
 
                     // check true collision with tile AABB
-                    if (const auto aabb =
-                            Tiles::get()[level.tiles[pos]]
-                                .aabb(level, pos)) {
+                    if (const auto aabb = tile.aabb(level, pos)) {
                         if (!ray.intersect_aabb(*aabb)) {
                             return hit_result;
                         }
@@ -220,44 +239,70 @@ void OcclusionMap::update(
     const ivec2 &center) {
     this->offset = math::xz_to_xyz(center - ivec2(SIZE.xz() / 2u), 0);
 
-    for (usize z = 0; z < SIZE.z; z++) {
-        for (usize y = 0; y < SIZE.y; y++) {
-            for (usize x = 0; x < SIZE.x; x++) {
-                const auto
-                    index_3d = (z * SIZE.y * SIZE.x) + (y * SIZE.x) + x,
-                    index_2d = (z * SIZE.x) + x;
-
-                const auto p = this->offset + ivec3(x, y, z);
-                const auto &tile = Tiles::get()[level.tiles[p]];
-
-                const auto occupied =
-                    !(tile == 0
-                        || tile.transparency_type() != Tile::Transparency::OFF);
-                this->data_full[index_3d] = occupied ? 0xFF : 0x00;
-
-                // compute top occlusion
-                if (y == SIZE.y - 1) {
-                    // check neighbors: if none, then mark occluded
-                    bool is_hidden = true;
-                    for (const auto &d : Direction::ALL) {
-                        const auto n = p + Direction::to_ivec3(d);
-
-                        if (!Level::in_bounds(n)) {
-                            continue;
-                        }
+    // positions which are not loaded are empty
+    std::fill(this->data_full.begin(), this->data_full.end(), 0);
+    std::fill(this->data_top.begin(), this->data_top.end(), 0);
+
+    level.for_each(
+        AABBi(this->offset, this->offset + ivec3(SIZE) - 1),
+        [&](const ivec3 &p, Chunk &chunk, u16 i) {
+            const auto d = p - this->offset;
+            const auto &tile =
+                Tiles::get()[Chunk::TileData::from(chunk.data.get(i))];
+
+            const auto occupied =
+                !(tile == 0
+                    || tile.transparency_type() != Tile::Transparency::OFF);
+            this->data_full[(d.z * SIZE.y * SIZE.x) + (d.y * SIZE.x) + d.x] =
+                occupied ? 0xFF : 0x00;
+        },
+        [](const Chunk &chunk) {
+            // all air chunks are already empty
+            return !chunk.uniform()
+                || Chunk::TileData::from(chunk.data.get(0)) != 0;
+        });
+
+    // compute top occlusion
+    level.for_each(
+        AABBi(
+            ivec3(this->offset.x, SIZE.y - 1, this->offset.z),
+            this->offset + ivec3(SIZE) - 1),
+        [&](const ivec3 &p, Chunk&, u16) {
+            const auto d = p - this->offset;
+
+            // check neighbors: if none, then mark occluded. neighbors which
+            // are in bounds but not loaded count as (transparent) air.
+            usize n_expected = 0, n_opaque = 0;
+            for (const auto &dir : Direction::ALL) {
+                if (Level::in_bounds(p + Direction::to_ivec3(dir))) {
+                    n_expected++;
+                }
+            }
 
-                        if (Tiles::get()[level.tiles[n]].transparency_type()
-                                != Tile::Transparency::OFF) {
-                            is_hidden = false;
-                            break;
-                        }
+            level.for_each_neighbor(
+                p,
+                [&](Direction::Enum,
+                    const ivec3 &n,
+                    Chunk &chunk_n,
+                    u16 i_n) {
+                    // neighbor is above its column's height, so air
+                    if (isize(
+                            chunk_n.height(
+                                Level::to_chunk_pos(n).xz())) <= n.y) {
+                        return;
                     }
 
-                    this->data_top[index_2d] = is_hidden ? 0xFF : 0x00;
-                }
-            }
-        }
-    }
+                    const auto tile_n =
+                        Chunk::TileData::from(chunk_n.data.get(i_n));
+                    if (Tiles::get()[tile_n].transparency_type()
+                            == Tile::Transparency::OFF) {
+                        n_opaque++;
+                    }
+                });
+
+            this->data_top[(d.z * SIZE.x) + d.x] =
+                n_opaque == n_expected ? 0xFF : 0x00;
+        });
 
     compute_blocking(
         *this,
@@ -268,6 +313,30 @@ void OcclusionMap::update(
         *this,
         level);
 
+    // ghost tiles, which chunk shaders resolve at draw time instead of chunks
+    // being remeshed every time a tile is (un)ghosted
+    std::fill(this->data_ghost.begin(), this->data_ghost.end(), 0);
+    this->ghost_chunks.clear();
+
+    for (const auto &[pos, _] : this->blocking) {
+        const auto d = pos - this->offset;
+        if (math::any(math::lessThan(d, ivec3(0)))
+                || math::any(math::greaterThanEqual(d, ivec3(SIZE)))
+                || !level.ghost[pos]) {
+            continue;
+        }
+
+        this->data_ghost[(d.z * SIZE.y * SIZE.x) + (d.y * SIZE.x) + d.x] =
+            0xFF;
+
+        // neighbors can have faces exposed by a ghost tile
+        this->ghost_chunks.insert(Level::to_offset(pos));
+        for (const auto &dir : Direction::CARDINAL) {
+            this->ghost_chunks.insert(
+                Level::to_offset(pos + Direction::to_ivec3(dir)));
+        }
+    }
+
     bgfx::updateTexture3D(
         this->texture_full,
         0, 0, 0, 0,
@@ -291,6 +360,14 @@ void OcclusionMap::update(
         bgfx::makeRef(
             &this->data_blocking[0],
             this->data_blocking.size() * sizeof(this->data_blocking[0])));
+
+    bgfx::updateTexture3D(
+        this->texture_ghost,
+        0, 0, 0, 0,
+        SIZE.x, SIZE.y, SIZE.z,
+        bgfx::makeRef(
+            &this->data_ghost[0],
+            this->data_ghost.size() * sizeof(this->data_ghost[0])));
 }
 
 void OcclusionMap::set_uniforms(
@@ -317,3 +394,18 @@ void OcclusionMap::set_uniforms(
         STRINGIFY(OCCM_SIZE_UNIFORM_NAME),
         vec4(OcclusionMap::SIZE, 0.0f));
 }
+
+void OcclusionMap::set_ghost_uniforms(
+    const Program &program,
+    u8 sampler_stage_ghost) const {
+    program.try_set(
+        STRINGIFY(OCCM_GHOST_SAMPLER_NAME),
+        sampler_stage_ghost,
+        this->texture_ghost);
+    program.try_set(
+        STRINGIFY(OCCM_OFFSET_UNIFORM_NAME),
+        vec4(this->offset, 0.0f));
+    program.try_set(
+        STRINGIFY(OCCM_SIZE_UNIFORM_NAME),
+        vec4(OcclusionMap::SIZE, 0.0f));
+}
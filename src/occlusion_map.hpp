@@ -8,8 +8,12 @@ struct GameCamera;
 struct OcclusionMap {
     static constexpr auto SIZE = uvec3(48, Chunk::SIZE.y, 48);
 
-    std::vector<u8> data_full, data_top, data_blocking;
-    Texture texture_full, texture_top, texture_blocking;
+    std::vector<u8> data_full, data_top, data_blocking, data_ghost;
+    Texture texture_full, texture_top, texture_blocking, texture_ghost;
+
+    // offsets of chunks containing or bordering ghost tiles (see
+    // data_ghost), only these need ghosting resolved when drawn
+    std::unordered_set<ivec2> ghost_chunks;
 
     struct BlockingInfo {
         usize first, last;
@@ -36,4 +40,10 @@ struct OcclusionMap {
         u8 sampler_stage_full,
         u8 sampler_stage_top,
         u8 sampler_stage_blocking) const;
+
+    // sets ghost texture and offset/size uniforms for chunk shaders, see
+    // ChunkRenderer::Pass
+    void set_ghost_uniforms(
+        const Program &program,
+        u8 sampler_stage_ghost) const;
 };
@@ -16,6 +16,9 @@ struct SerializationContextLevel
     [[SERIALIZE_IGNORE]] Level *level = nullptr;
     [[SERIALIZE_IGNORE]] EntityPlayer *player = nullptr;
 
+    // errors which make the result of (de)serialization unusable, see fail()
+    [[SERIALIZE_IGNORE]] std::vector<std::string> errors;
+
     SerializationContextLevel() = default;
 
     void notify_alloc(const arc::any &ptr, arc::type_id id) override {
@@ -40,4 +43,15 @@ struct SerializationContextLevel
     Level *get_level() const {
         return this->level;
     }
+
+    // records an error, (de)serialization continues but its result must not
+    // be used
+    void fail(std::string &&error) {
+        WARN("{}", error);
+        this->errors.push_back(std::move(error));
+    }
+
+    bool failed() const {
+        return !this->errors.empty();
+    }
 };
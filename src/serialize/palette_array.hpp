@@ -0,0 +1,35 @@
+#pragma once
+
+#include "serialize/serializer.hpp"
+#include "serialize/vector.hpp"
+#include "serialize/math.hpp"
+#include "util/palette_array.hpp"
+#include "util/util.hpp"
+
+// PaletteArray serializer, stores the packed representation as-is
+template <typename T, usize N>
+struct [[SERIALIZER]] Serializer<PaletteArray<T, N>>
+    : SerializerImpl<PaletteArray<T, N>> {
+    using ArrayType = PaletteArray<T, N>;
+
+    void serialize(
+        const ArrayType &arr,
+        Archive &archive,
+        SerializationContext &ctx) const {
+        Serializer<u8>().serialize(arr._bits, archive, ctx);
+        Serializer<std::vector<T>>().serialize(arr._palette, archive, ctx);
+        Serializer<std::vector<u16>>().serialize(arr._counts, archive, ctx);
+        Serializer<std::vector<u64>>().serialize(arr.words, archive, ctx);
+    }
+
+    void deserialize(
+        ArrayType &arr,
+        Archive &archive,
+        SerializationContext &ctx) const {
+        Serializer<u8>().deserialize(arr._bits, archive, ctx);
+        Serializer<std::vector<T>>().deserialize(arr._palette, archive, ctx);
+        Serializer<std::vector<u16>>().deserialize(arr._counts, archive, ctx);
+        Serializer<std::vector<u64>>().deserialize(arr.words, archive, ctx);
+        ASSERT(arr._palette.size() == arr._counts.size());
+    }
+};
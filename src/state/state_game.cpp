@@ -20,6 +20,7 @@
 #include "levelgen/gen.hpp"
 #include "level/level.hpp"
 #include "level/level_renderer.hpp"
+#include "level/light_clusters.hpp"
 #include "level/chunk.hpp"
 #include "platform/platform.hpp"
 #include "ui/ui_root.hpp"
@@ -38,6 +39,16 @@
 // TODO: remove
 #include "serialize/context_level.hpp"
 
+// size of level, in chunks. chunks are streamed in around the camera.
+static constexpr auto LEVEL_SIZE = ivec2(64, 64);
+
+// directory which chunks out of range of the camera are paged out to
+static constexpr auto LEVEL_STREAM_PATH = "level";
+
+static void generate_chunk(Level &level, Chunk &chunk) {
+    DefaultLevelGenerator().generate(level, chunk);
+}
+
 void StateGame::init() {
     this->allocator =
         BumpAllocator(
@@ -49,10 +60,8 @@ void StateGame::init() {
             this->allocator,
             &this->allocator,
             0,
-            ivec2(2, 2),
-            [](Level &level) {
-                DefaultLevelGenerator().generate(level);
-            });
+            LEVEL_SIZE,
+            LevelStreamer(LEVEL_STREAM_PATH, generate_chunk));
 
     this->level_renderer =
         make_alloc_ptr<LevelRenderer>(this->allocator, *this->level);
@@ -67,8 +76,12 @@ void StateGame::init() {
     this->sun =
         make_alloc_ptr<Sun>(this->allocator);
 
+    // player spawns at the center, which must be loaded first
     const auto aabb_l = this->level->aabb();
     const auto center_l = ivec2(aabb_l.center().xz());
+    this->level->streamer->load_all(
+        *this->level, AABB2i(center_l, center_l));
+
     this->player = this->level->spawn_at_xz<EntityPlayer>(center_l);
     this->camera_entity = this->player;
     ASSERT(this->player);
@@ -132,7 +145,11 @@ void StateGame::tick() {
         Serializer<alloc_ptr<Level>>()
             .serialize(this->level, archive, ctx);
 
-        file::write_file("save.dat", archive.buffer());
+        if (ctx.failed()) {
+            WARN("not saving, level could not be serialized");
+        } else {
+            file::write_file("save.dat", archive.buffer());
+        }
     } else if (keyboard["l"]->is_pressed_tick()) {
         SerializationContextLevel ctx;
         ctx.base_allocator = &global.allocator;
@@ -144,6 +161,11 @@ void StateGame::tick() {
             .deserialize(this->level, archive, ctx);
         ctx.resolve();
 
+        // generator is not saved
+        if (this->level->streamer) {
+            this->level->streamer->generate = generate_chunk;
+        }
+
         this->player = ctx.player;
         this->camera->level = this->level.get();
         this->camera_entity = this->player;
@@ -158,6 +180,13 @@ void StateGame::tick() {
         this->camera->follow(*entity);
     }
 
+    // page chunks in/out around the camera for streaming levels
+    if (this->level->streamer) {
+        this->level->streamer->update(
+            *this->level,
+            this->camera->render_bounds());
+    }
+
     Renderer::get().entity_highlighter->tick();
 
     this->camera->tick(*this->level);
@@ -220,13 +249,21 @@ void StateGame::render() {
 
     this->camera->update();
 
-    // retreive lights for compositing
-    // TODO: prioritize with more than MAX_LIGHTS lights
-    auto lights = global.frame_allocator.alloc_span<Light>(1024);
+    // retreive lights for compositing, any past MAX_LIGHTS are dropped
+    // before binning (cells themselves keep their closest lights)
+    const auto light_bounds = this->camera->light_bounds();
+    auto lights = global.frame_allocator.alloc_span<Light>(MAX_LIGHTS);
     const auto [n_lights, _] = level->lights(
         lights,
-        this->camera->light_bounds().ntransform<3>(
+        light_bounds.ntransform<3>(
             [](ivec2 v) { return math::xz_to_xyz(v, 0); }));
+    lights = lights.subspan(0, n_lights);
+
+    // bin lights so that each pixel only considers nearby lights
+    LightClusters clusters;
+    if (clusters.build(lights, light_bounds)) {
+        WARN("too many lights, some were dropped from light clusters");
+    }
 
     renderer.composite(
         *this->camera,
@@ -236,7 +273,8 @@ void StateGame::render() {
         [&](RenderState render_state) { this->render_ui(render_state); },
         *this->sun,
         *this->occlusion_map,
-        lights.subspan(0, math::min<usize>(n_lights, MAX_LIGHTS)));
+        lights,
+        clusters);
 
     renderer.debug->reset();
 }
@@ -52,11 +52,16 @@ struct Tile {
         return nullptr;
     }
 
-    // called at rate defined in level.hpp
+    // called at rate defined in level.hpp, only if random_tickable() is true
     virtual void random_tick(
         Level &level,
         const ivec3 &pos) const {}
 
+    // if true, tile is tracked by its chunk to receive random ticks
+    virtual bool random_tickable() const {
+        return false;
+    }
+
     // used to enable light gathering for this tile
     virtual bool can_emit_light() const {
         return false;
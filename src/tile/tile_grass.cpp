@@ -26,7 +26,6 @@ struct TileRendererGrass : public TileRendererSided {
     std::vector<const VoxelMultiMeshEntry*> extras;
 
     mutable MultiMeshInstanceBuffer instance_buffer;
-    mutable MultiMeshInstancer::RenderData instance_data;
 
     TileRendererGrass(const Tile &tile)
         : Base(
@@ -94,10 +93,11 @@ struct TileRendererGrass : public TileRendererSided {
         return true;
     }
 
-    void render_extras(
-        RenderContext &ctx,
+    void instance_extras(
         const Level *level,
-        const ivec3 &pos) const override {
+        const ivec3 &pos,
+        std::vector<ModelInstanceData> &data,
+        std::vector<const MultiMeshEntry*> &meshes) const override {
         if (level && level->tiles[pos + ivec3(0, 1, 0)] != 0) {
             return;
         }
@@ -109,8 +109,6 @@ struct TileRendererGrass : public TileRendererSided {
             const auto center_offset =
                 math::xyz_to_xnz(mesh.bounds().size(), 0.0f) / 2.0f;
 
-            // TODO: if this becomes too much of a performance drag a lot of the
-            // more expensive matrices here can be precomputed and saved
             // manually compute normal matrix to save a costly
             // inverse-transpose :)
             auto m = mat4(1.0), n = mat4(1.0);
@@ -131,17 +129,21 @@ struct TileRendererGrass : public TileRendererSided {
             m *= r;
             n *= r;
             m = math::translate(m, -center_offset);
-            this->instance_buffer.push(
+            data.push_back(
                 ModelInstanceData {
                     .model = m,
                     .normal = mat3(n),
                     .flags = 0,
                     .id = 0
-                },
-                &mesh);
+                });
+            meshes.push_back(&mesh);
         }
     }
 
+    MultiMeshInstanceBuffer *instanced_extras_buffer() const override {
+        return &this->instance_buffer;
+    }
+
     bool has_instanced_extras() const override {
         return true;
     }
@@ -149,16 +151,19 @@ struct TileRendererGrass : public TileRendererSided {
     void render_instanced_extras(
         RenderContext &ctx,
         const Level *level) const override {
-        this->instance_data =
-            Renderer::get().mm_instancer->push(this->instance_buffer);
+        // NOTE: called once per view, data is kept with the context rather
+        // than the renderer
+        auto *data =
+            ctx.allocator->alloc<MultiMeshInstancer::RenderData>(
+                Renderer::get().mm_instancer->push(this->instance_buffer));
         this->instance_buffer.clear();
 
         ctx.push(
             RenderCtxFn {
-                [this](const RenderGroup&, RenderState render_state) {
+                [data](const RenderGroup&, RenderState render_state) {
                     Renderer::get().mm_instancer
                         ->render(
-                            this->instance_data,
+                            *data,
                             render_state.or_defaults(),
                             Renderer::get().programs["model_instanced"]);
                 },
@@ -102,6 +102,7 @@ void TileRenderer::render(
 
     const auto &program = Renderer::get().programs["chunk"];
     program.set("u_alpha", vec4(alpha));
+    program.try_set("u_ghost", vec4(0));
     TileRenderer::render(
         program,
         math::translate(mat4(1.0), vec3(pos)),
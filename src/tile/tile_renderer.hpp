@@ -63,9 +63,25 @@ struct TileRenderer {
         return false;
     }
 
-    // TODO: re-doc
+    // if has_instanced_extras(), appends instances of the extras of the tile
+    // at pos to data/meshes. results are cached per chunk (see
+    // ChunkRenderer::extras()) and only rebuilt when the chunk changes, so
+    // they must only depend on level data.
+    virtual void instance_extras(
+        const Level *level,
+        const ivec3 &pos,
+        std::vector<ModelInstanceData> &data,
+        std::vector<const MultiMeshEntry*> &meshes) const {}
+
+    // if has_instanced_extras(), buffer which the cached instances of visible
+    // tiles are gathered into every frame before render_instanced_extras()
+    virtual MultiMeshInstanceBuffer *instanced_extras_buffer() const {
+        return nullptr;
+    }
+
     // if has_instanced_extras(), called by level renderer after all chunk
-    // rendering ONCE per tile renderer
+    // rendering ONCE per tile renderer and view (camera, sun), with the
+    // instances of that view's tiles in instanced_extras_buffer()
     virtual void render_instanced_extras(
         RenderContext &ctx,
         const Level *level) const {}
@@ -46,4 +46,8 @@ struct TileSunCrystal : public TileOre {
             Level::to_tile_center(pos), 2, 4,
             *this);
     }
+
+    bool random_tickable() const override {
+        return true;
+    }
 };
@@ -29,6 +29,10 @@ struct TileTorch : public Tile {
         TileTorch::emit_particles(level, Level::to_tile_center(pos));
     }
 
+    bool random_tickable() const override {
+        return true;
+    }
+
     bool can_emit_light() const override {
         return true;
     }
@@ -0,0 +1,333 @@
+#pragma once
+
+#include "util/types.hpp"
+#include "util/util.hpp"
+#include "util/assert.hpp"
+
+// fixed-size array of N integral values, stored as bit-packed indices into a
+// palette of the distinct values present in the array.
+//
+// index width is always a power of two (0, 1, 2, 4, 8 bits) so that indices
+// never straddle words. the width expands automatically as the palette grows,
+// and once the palette would need more than MAX_PALETTE_BITS the array falls
+// back to direct (unpaletted) storage. compact() can be used to shrink an
+// array back down after its contents have become less varied.
+template <typename T, usize N>
+    requires (std::is_integral_v<T> && sizeof(T) <= sizeof(u64))
+struct PaletteArray {
+    using Word = u64;
+
+    // largest index width before switching to direct storage
+    static constexpr usize MAX_PALETTE_BITS = 8;
+
+    // index width of direct storage, values are stored as-is
+    static constexpr usize DIRECT_BITS = sizeof(Word) * 8;
+
+    static_assert(N <= std::numeric_limits<u16>::max());
+
+    PaletteArray() : PaletteArray(T(0)) {}
+
+    explicit PaletteArray(const T &value) {
+        this->fill(value);
+    }
+
+    inline T get(usize i) const {
+        if (this->_bits == 0) {
+            return this->_palette[0];
+        } else if (this->_bits == DIRECT_BITS) {
+            return static_cast<T>(this->words[i]);
+        }
+
+        return this->_palette[this->index(i)];
+    }
+
+    inline T operator[](usize i) const {
+        return this->get(i);
+    }
+
+    void set(usize i, const T &value) {
+        if (this->_bits == DIRECT_BITS) {
+            this->words[i] = static_cast<Word>(value);
+            return;
+        }
+
+        const auto old = this->_bits == 0 ? 0 : this->index(i);
+        if (this->_palette[old] == value) {
+            return;
+        }
+
+        usize index;
+        if (const auto found = this->find(value)) {
+            index = *found;
+        } else if (this->_counts[old] == 1) {
+            // only user of the old entry, replace it in-place
+            this->_palette[old] = value;
+            return;
+        } else {
+            index = this->insert(value);
+
+            // insert() may have switched storage modes
+            if (this->_bits == DIRECT_BITS) {
+                this->words[i] = static_cast<Word>(value);
+                return;
+            }
+        }
+
+        this->_counts[old]--;
+        this->_counts[index]++;
+        this->set_index(i, index);
+    }
+
+    // set every value in the array to value
+    void fill(const T &value) {
+        this->_bits = 0;
+        this->_palette.assign(1, value);
+        this->_counts.assign(1, N);
+        this->words.clear();
+        this->words.shrink_to_fit();
+    }
+
+    // copy all values in the array to dst
+    void unpack(std::span<T> dst) const {
+        ASSERT(dst.size() >= N);
+
+        if (this->_bits == 0) {
+            std::fill(dst.begin(), dst.begin() + N, this->_palette[0]);
+        } else if (this->_bits == DIRECT_BITS) {
+            for (usize i = 0; i < N; i++) {
+                dst[i] = static_cast<T>(this->words[i]);
+            }
+        } else {
+            const auto
+                per_word = DIRECT_BITS / this->_bits,
+                mask = (Word(1) << this->_bits) - 1;
+
+            usize i = 0;
+            for (const auto w : this->words) {
+                for (usize j = 0; j < per_word && i < N; j++, i++) {
+                    dst[i] = this->_palette[(w >> (j * this->_bits)) & mask];
+                }
+            }
+        }
+    }
+
+    // set all values in the array from src, building the smallest possible
+    // palette for them
+    void pack(std::span<const T> src) {
+        ASSERT(src.size() >= N);
+
+        std::vector<T> palette;
+        for (usize i = 0; i < N; i++) {
+            if (std::find(palette.begin(), palette.end(), src[i])
+                    == palette.end()) {
+                palette.push_back(src[i]);
+
+                if (palette.size() > (usize(1) << MAX_PALETTE_BITS)) {
+                    break;
+                }
+            }
+        }
+
+        if (palette.size() == 1) {
+            this->fill(palette[0]);
+            return;
+        }
+
+        const auto bits = bits_for(palette.size());
+        this->_bits = bits;
+
+        if (bits == DIRECT_BITS) {
+            this->_palette.clear();
+            this->_counts.clear();
+            this->words.resize(N);
+            for (usize i = 0; i < N; i++) {
+                this->words[i] = static_cast<Word>(src[i]);
+            }
+            return;
+        }
+
+        this->_palette = std::move(palette);
+        this->_counts.assign(this->_palette.size(), 0);
+        this->words.assign(num_words(bits), 0);
+
+        for (usize i = 0; i < N; i++) {
+            const auto index =
+                std::find(
+                    this->_palette.begin(),
+                    this->_palette.end(),
+                    src[i]) - this->_palette.begin();
+            this->_counts[index]++;
+            this->set_index(i, index);
+        }
+    }
+
+    // rebuild palette from the values currently in the array
+    void compact() {
+        if (this->_bits == 0) {
+            return;
+        } else if (this->_bits != DIRECT_BITS) {
+            // nothing to gain unless enough palette entries are dead
+            const auto live =
+                std::count_if(
+                    this->_counts.begin(),
+                    this->_counts.end(),
+                    [](u16 c) { return c != 0; });
+
+            if (live > 1 && bits_for(live) >= this->_bits) {
+                return;
+            }
+        }
+
+        std::vector<T> values(N);
+        this->unpack(values);
+        this->pack(values);
+    }
+
+    // current index width in bits (0 if uniform, DIRECT_BITS if unpaletted)
+    inline usize bits() const {
+        return this->_bits;
+    }
+
+    // true if every value in the array is the same
+    inline bool uniform() const {
+        return this->_bits == 0;
+    }
+
+    // true if storage is not paletted
+    inline bool direct() const {
+        return this->_bits == DIRECT_BITS;
+    }
+
+    // current palette, may contain unused entries (see counts())
+    inline std::span<const T> palette() const {
+        return this->_palette;
+    }
+
+    // number of uses of each palette entry
+    inline std::span<const u16> counts() const {
+        return this->_counts;
+    }
+
+    // approximate number of heap bytes used by this array
+    inline usize size_bytes() const {
+        return this->_palette.capacity() * sizeof(T)
+            + this->_counts.capacity() * sizeof(u16)
+            + this->words.capacity() * sizeof(Word);
+    }
+
+    inline bool operator==(const PaletteArray &other) const {
+        for (usize i = 0; i < N; i++) {
+            if (this->get(i) != other.get(i)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    // smallest power-of-two index width which can hold n palette entries
+    static inline usize bits_for(usize n) {
+        for (usize bits = 1; bits <= MAX_PALETTE_BITS; bits *= 2) {
+            if (n <= (usize(1) << bits)) {
+                return bits;
+            }
+        }
+
+        return DIRECT_BITS;
+    }
+
+    static inline usize num_words(usize bits) {
+        return ((N * bits) + (DIRECT_BITS - 1)) / DIRECT_BITS;
+    }
+
+    inline usize index(usize i) const {
+        const auto b = i * this->_bits;
+        return
+            (this->words[b / DIRECT_BITS] >> (b % DIRECT_BITS))
+                & ((Word(1) << this->_bits) - 1);
+    }
+
+    inline void set_index(usize i, usize index) {
+        const auto
+            b = i * this->_bits,
+            shift = b % DIRECT_BITS;
+        const auto mask = ((Word(1) << this->_bits) - 1) << shift;
+        auto &w = this->words[b / DIRECT_BITS];
+        w = (w & ~mask) | ((static_cast<Word>(index) << shift) & mask);
+    }
+
+    // find palette index of value among live entries
+    inline std::optional<usize> find(const T &value) const {
+        for (usize i = 0; i < this->_palette.size(); i++) {
+            if (this->_palette[i] == value && this->_counts[i] != 0) {
+                return i;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    // insert value into palette with a count of zero, returns its index.
+    // expands index width if necessary.
+    usize insert(const T &value) {
+        // reuse dead entries first
+        for (usize i = 0; i < this->_palette.size(); i++) {
+            if (this->_counts[i] == 0) {
+                this->_palette[i] = value;
+                return i;
+            }
+        }
+
+        const auto index = this->_palette.size();
+        this->_palette.push_back(value);
+        this->_counts.push_back(0);
+
+        if (this->_palette.size() > (usize(1) << this->_bits)) {
+            this->resize(bits_for(this->_palette.size()));
+        }
+
+        return index;
+    }
+
+    // re-pack indices to the specified index width
+    void resize(usize bits) {
+        std::vector<Word> words(
+            bits == DIRECT_BITS ? N : num_words(bits), 0);
+
+        for (usize i = 0; i < N; i++) {
+            const auto index = this->_bits == 0 ? 0 : this->index(i);
+
+            if (bits == DIRECT_BITS) {
+                words[i] = static_cast<Word>(this->_palette[index]);
+            } else {
+                const auto b = i * bits;
+                words[b / DIRECT_BITS] |=
+                    static_cast<Word>(index) << (b % DIRECT_BITS);
+            }
+        }
+
+        this->words = std::move(words);
+        this->_bits = bits;
+
+        if (bits == DIRECT_BITS) {
+            this->_palette.clear();
+            this->_counts.clear();
+        }
+    }
+
+    // current index width
+    u8 _bits = 0;
+
+    // distinct values, indexed by packed indices
+    std::vector<T> _palette;
+
+    // number of indices pointing at each palette entry
+    std::vector<u16> _counts;
+
+    // packed indices, or values directly if _bits == DIRECT_BITS
+    std::vector<Word> words;
+
+    template <typename>
+    friend struct Serializer;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <map>
+
+#include "util/types.hpp"
+#include "util/util.hpp"
+#include "util/assert.hpp"
+
+// first-fit allocator of ranges of [0, capacity()), for sub-allocating a
+// single large buffer. free ranges are kept ordered by offset and coalesced
+// on free(). when no free range fits, capacity grows (doubling) and the
+// caller is expected to grow whatever storage backs the allocator to match.
+struct RangeAllocator {
+    struct Range {
+        usize offset = 0, size = 0;
+
+        inline usize end() const {
+            return this->offset + this->size;
+        }
+
+        inline bool empty() const {
+            return this->size == 0;
+        }
+    };
+
+    RangeAllocator() = default;
+
+    explicit RangeAllocator(usize capacity)
+        : _capacity(capacity) {
+        if (capacity != 0) {
+            this->free_ranges[0] = capacity;
+        }
+    }
+
+    // allocates n contiguous elements, growing if necessary. n == 0 returns
+    // an empty range.
+    Range alloc(usize n) {
+        if (n == 0) {
+            return Range();
+        }
+
+        for (auto it = this->free_ranges.begin();
+             it != this->free_ranges.end();
+             it++) {
+            const auto [offset, size] = *it;
+            if (size < n) {
+                continue;
+            }
+
+            this->free_ranges.erase(it);
+            if (size != n) {
+                this->free_ranges[offset + n] = size - n;
+            }
+
+            this->_used += n;
+            return Range { offset, n };
+        }
+
+        // grow, free space at the end of the current capacity counts
+        usize tail = 0;
+        if (!this->free_ranges.empty()) {
+            const auto &[offset, size] = *this->free_ranges.rbegin();
+            if (offset + size == this->_capacity) {
+                tail = size;
+            }
+        }
+
+        usize capacity = std::max<usize>(this->_capacity, 1);
+        while (tail + (capacity - this->_capacity) < n) {
+            capacity *= 2;
+        }
+
+        this->insert(this->_capacity, capacity - this->_capacity);
+        this->_capacity = capacity;
+        return this->alloc(n);
+    }
+
+    // returns range to the allocator, empty ranges are ignored
+    void free(const Range &range) {
+        if (range.empty()) {
+            return;
+        }
+
+        ASSERT(range.end() <= this->_capacity);
+        ASSERT(this->_used >= range.size);
+        this->_used -= range.size;
+        this->insert(range.offset, range.size);
+    }
+
+    // total number of elements, allocated or not
+    inline usize capacity() const {
+        return this->_capacity;
+    }
+
+    // number of allocated elements
+    inline usize used() const {
+        return this->_used;
+    }
+
+    // number of separate free ranges, a measure of fragmentation
+    inline usize num_free_ranges() const {
+        return this->free_ranges.size();
+    }
+
+private:
+    // adds free range, merging with its neighbors
+    void insert(usize offset, usize size) {
+        auto next = this->free_ranges.lower_bound(offset);
+        ASSERT(next == this->free_ranges.end() || next->first >= offset + size);
+
+        if (next != this->free_ranges.begin()) {
+            auto prev = std::prev(next);
+            ASSERT(prev->first + prev->second <= offset);
+
+            if (prev->first + prev->second == offset) {
+                offset = prev->first;
+                size += prev->second;
+                this->free_ranges.erase(prev);
+            }
+        }
+
+        if (next != this->free_ranges.end() && next->first == offset + size) {
+            size += next->second;
+            this->free_ranges.erase(next);
+        }
+
+        this->free_ranges[offset] = size;
+    }
+
+    usize _capacity = 0, _used = 0;
+
+    // offset -> size of each free range
+    std::map<usize, usize> free_ranges;
+};
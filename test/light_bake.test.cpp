@@ -0,0 +1,122 @@
+#include "test.hpp"
+
+#include "level/light_bake.hpp"
+
+#include <random>
+
+// world size in tiles, split into chunks by Grid
+static constexpr auto WORLD = ivec3(64, 8, 64);
+static constexpr usize WORLD_VOLUME = WORLD.x * WORLD.y * WORLD.z;
+
+// world index of world space position
+static inline usize world_index(const ivec3 &p) {
+    return (((p.x * WORLD.y) + p.y) * WORLD.z) + p.z;
+}
+
+// light_bake grid over a shared world of X by Z chunks
+template <isize X, isize Z>
+struct Grid {
+    static constexpr auto SIZE = ivec3(X, WORLD.y, Z);
+    static constexpr auto CHUNKS = ivec2(WORLD.x / X, WORLD.z / Z);
+
+    const std::vector<bool> &solid;
+    std::vector<u8> light = std::vector<u8>(WORLD_VOLUME, 0);
+
+    explicit Grid(const std::vector<bool> &solid) : solid(solid) {}
+
+    static inline ivec3 origin(usize c) {
+        return ivec3((c % CHUNKS.x) * X, 0, (c / CHUNKS.x) * Z);
+    }
+
+    // per chunk seeds from world space seeds
+    static std::vector<std::vector<light_bake::Node>> split(
+        std::span<const light_bake::Node> seeds) {
+        std::vector<std::vector<light_bake::Node>> result(
+            CHUNKS.x * CHUNKS.y);
+
+        for (const auto &[pos, value] : seeds) {
+            const auto c = ((pos.z / Z) * CHUNKS.x) + (pos.x / X);
+            result[c].emplace_back(pos - origin(c), value);
+        }
+
+        return result;
+    }
+
+    inline usize size() const {
+        return CHUNKS.x * CHUNKS.y;
+    }
+
+    inline isize neighbor(usize c, const ivec2 &d) const {
+        const auto o = ivec2(c % CHUNKS.x, c / CHUNKS.x) + d;
+        return ndarray::in_bounds(CHUNKS, o) ? (o.y * CHUNKS.x) + o.x : -1;
+    }
+
+    inline std::tuple<u8, bool> read(usize c, const ivec3 &pos) const {
+        const auto i = world_index(origin(c) + pos);
+        return { this->light[i], !this->solid[i] };
+    }
+
+    inline void write(usize c, const ivec3 &pos, u8 light) {
+        this->light[world_index(origin(c) + pos)] = light;
+    }
+
+    void clear(usize c) {
+        ndarray::each(SIZE, [&](const ivec3 &pos) { this->write(c, pos, 0); });
+    }
+
+    inline bool dark(usize) const { return false; }
+
+    inline bool opaque(usize) const { return false; }
+};
+
+template <isize X, isize Z>
+static std::vector<u8> bake(
+    const std::vector<bool> &solid,
+    std::span<const light_bake::Node> seeds) {
+    auto grid = Grid<X, Z>(solid);
+    auto split = Grid<X, Z>::split(seeds);
+    light_bake::bake(grid, split);
+    return grid.light;
+}
+
+int main(int argc, char *argv[]) {
+    // a single source in an empty world falls off by one per tile
+    {
+        const std::vector<bool> solid(WORLD_VOLUME, false);
+        const std::array<light_bake::Node, 1> seeds = {
+            light_bake::Node(ivec3(31, 3, 32), 15)
+        };
+
+        const auto light = bake<16, 16>(solid, seeds);
+        ndarray::each(WORLD, [&](const ivec3 &p) {
+            const auto d = math::abs(p - seeds[0].pos);
+            const auto expected = math::max(15 - (d.x + d.y + d.z), 0);
+            ASSERT(light[world_index(p)] == expected);
+        });
+    }
+
+    // chunked bakes of random worlds match a single chunk bake (which never
+    // reconciles borders) exactly
+    std::mt19937 rng(0x11C0);
+    for (usize n = 0; n < 8; n++) {
+        std::vector<bool> solid(WORLD_VOLUME);
+        for (usize i = 0; i < WORLD_VOLUME; i++) {
+            solid[i] = (rng() % 100) < 35;
+        }
+
+        std::vector<light_bake::Node> seeds;
+        for (usize i = 0; i < 24; i++) {
+            seeds.emplace_back(
+                ivec3(rng() % WORLD.x, rng() % WORLD.y, rng() % WORLD.z),
+                1 + (rng() % 15));
+        }
+
+        const auto expected = bake<WORLD.x, WORLD.z>(solid, seeds);
+        ASSERT(bake<32, 32>(solid, seeds) == expected);
+        ASSERT(bake<16, 16>(solid, seeds) == expected);
+        ASSERT(bake<8, 32>(solid, seeds) == expected);
+        ASSERT(bake<4, 4>(solid, seeds) == expected);
+    }
+
+    return 0;
+}
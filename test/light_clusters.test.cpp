@@ -0,0 +1,63 @@
+#include "test.hpp"
+
+#include "level/light_clusters.hpp"
+
+int main(int argc, char *argv[]) {
+    const auto area = AABB2i(ivec2(0), ivec2(127));
+
+    // default attenuation reaches ~22 tiles
+    const auto light = Light(vec3(64.5f, 2.0f, 64.5f), vec3(1.0f), 15);
+    const auto r = light.radius();
+    ASSERT(r > 20.0f && r < 24.0f);
+
+    // no lights, every cell is empty
+    LightClusters clusters;
+    ASSERT(!clusters.build({}, area));
+    ASSERT(clusters.dims == ivec2(16));
+    ASSERT(clusters.indices.empty());
+    ASSERT(clusters.lights(ivec2(64)).empty());
+
+    // a single light is in every cell in its radius, and only those
+    const std::array<Light, 1> one = { light };
+    ASSERT(!clusters.build(one, area));
+
+    for (isize x = 0; x <= area.max.x; x++) {
+        for (isize z = 0; z <= area.max.y; z++) {
+            const auto d = math::length(vec2(x, z) - light.pos.xz());
+            const auto ls = clusters.lights(ivec2(x, z));
+
+            if (d <= r) {
+                ASSERT(ls.size() == 1 && ls[0] == 0);
+            } else if (d > r + (2.0f * LightClusters::CELL_SIZE)) {
+                ASSERT(ls.empty());
+            }
+        }
+    }
+
+    // lights outside of the area are not binned, lights overlapping it are
+    const std::array<Light, 2> outside = {
+        Light(vec3(-100.0f, 0.0f, 0.0f), vec3(1.0f), 15),
+        Light(vec3(-10.0f, 0.0f, 10.0f), vec3(1.0f), 15)
+    };
+    ASSERT(!clusters.build(outside, area));
+    ASSERT(clusters.lights(ivec2(0, 10)).size() == 1);
+    ASSERT(clusters.lights(ivec2(0, 10))[0] == 1);
+
+    // large areas grow cells instead of exceeding MAX_CELLS
+    ASSERT(!clusters.build({}, AABB2i(ivec2(0), ivec2(4095))));
+    ASSERT(clusters.cell_size > LightClusters::CELL_SIZE);
+    ASSERT(
+        usize(clusters.dims.x * clusters.dims.y) <= LightClusters::MAX_CELLS);
+
+    // too many lights in one place overflow, but each cell is still capped
+    std::vector<Light> many(
+        LightClusters::MAX_PER_CELL + 8, light);
+    ASSERT(clusters.build(many, area));
+    const auto ls = clusters.lights(ivec2(64));
+    ASSERT(ls.size() == LightClusters::MAX_PER_CELL);
+    for (usize i = 0; i < ls.size(); i++) {
+        ASSERT(ls[i] == i);
+    }
+
+    return 0;
+}
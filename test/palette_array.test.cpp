@@ -0,0 +1,93 @@
+#include "test.hpp"
+
+#include "util/palette_array.hpp"
+
+int main(int argc, char *argv[]) {
+    constexpr usize N = 4096;
+
+    // uniform arrays use no index storage
+    PaletteArray<u64, N> a;
+    ASSERT(a.uniform());
+    ASSERT(a.bits() == 0);
+    ASSERT(a.get(0) == 0);
+    ASSERT(a.get(N - 1) == 0);
+
+    // setting to the same value does nothing
+    a.set(7, 0);
+    ASSERT(a.uniform());
+
+    // palette expands as values are added
+    a.set(7, 0xFF00000000000001);
+    ASSERT(a.bits() == 1);
+    ASSERT(a.get(7) == 0xFF00000000000001);
+    ASSERT(a.get(6) == 0);
+    ASSERT(a.get(8) == 0);
+
+    a.set(8, 2);
+    a.set(9, 3);
+    ASSERT(a.bits() == 2);
+    ASSERT(a.get(7) == 0xFF00000000000001);
+    ASSERT(a.get(8) == 2);
+    ASSERT(a.get(9) == 3);
+
+    for (usize i = 0; i < 200; i++) {
+        a.set(i, i + 1000);
+    }
+    ASSERT(a.bits() == 8);
+
+    for (usize i = 0; i < 200; i++) {
+        ASSERT(a.get(i) == i + 1000);
+    }
+    ASSERT(a.get(200) == 0);
+
+    // overwriting values frees their palette entries for reuse
+    for (usize i = 0; i < 200; i++) {
+        a.set(i, 5);
+    }
+    for (usize i = 0; i < 200; i++) {
+        a.set(i, i + 2000);
+    }
+    ASSERT(a.bits() == 8);
+    for (usize i = 0; i < 200; i++) {
+        ASSERT(a.get(i) == i + 2000);
+    }
+
+    // falls back to direct storage when palette is too large
+    for (usize i = 0; i < N; i++) {
+        a.set(i, i * 3);
+    }
+    ASSERT(a.direct());
+    for (usize i = 0; i < N; i++) {
+        ASSERT(a.get(i) == i * 3);
+    }
+
+    // compaction shrinks back down
+    for (usize i = 0; i < N; i++) {
+        a.set(i, i % 3);
+    }
+    ASSERT(a.direct());
+    a.compact();
+    ASSERT(a.bits() == 2);
+    for (usize i = 0; i < N; i++) {
+        ASSERT(a.get(i) == i % 3);
+    }
+
+    // unpack/pack round trip
+    std::vector<u64> values(N);
+    a.unpack(values);
+    for (usize i = 0; i < N; i++) {
+        ASSERT(values[i] == i % 3);
+    }
+
+    PaletteArray<u64, N> b;
+    b.pack(values);
+    ASSERT(a == b);
+    ASSERT(b.bits() == 2);
+
+    b.fill(12);
+    ASSERT(b.uniform());
+    ASSERT(b.get(N / 2) == 12);
+    ASSERT(a != b);
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "test.hpp"
+
+#include "util/range_allocator.hpp"
+
+int main(int argc, char *argv[]) {
+    RangeAllocator a(16);
+    ASSERT(a.capacity() == 16);
+    ASSERT(a.used() == 0);
+    ASSERT(a.num_free_ranges() == 1);
+
+    // empty allocations take no space
+    ASSERT(a.alloc(0).empty());
+    ASSERT(a.used() == 0);
+
+    // first fit, in order
+    const auto r0 = a.alloc(4), r1 = a.alloc(4), r2 = a.alloc(4);
+    ASSERT(r0.offset == 0 && r0.size == 4);
+    ASSERT(r1.offset == 4 && r1.size == 4);
+    ASSERT(r2.offset == 8 && r2.size == 4);
+    ASSERT(a.used() == 12);
+
+    // freeing the middle leaves a hole which is reused
+    a.free(r1);
+    ASSERT(a.num_free_ranges() == 2);
+    const auto r3 = a.alloc(2);
+    ASSERT(r3.offset == 4);
+
+    // too large for any hole, goes at the end
+    const auto r4 = a.alloc(4);
+    ASSERT(r4.offset == 12);
+    ASSERT(a.capacity() == 16);
+
+    // out of space, grows by doubling and keeps existing ranges in place
+    const auto r5 = a.alloc(8);
+    ASSERT(a.capacity() == 32);
+    ASSERT(r5.offset == 16);
+
+    // free space at the end counts toward growth
+    a.free(r5);
+    const auto r6 = a.alloc(24);
+    ASSERT(a.capacity() == 64);
+    ASSERT(r6.offset == 16);
+    a.free(r6);
+
+    // freeing everything coalesces back into a single range
+    a.free(r0);
+    a.free(r2);
+    a.free(r3);
+    a.free(r4);
+    ASSERT(a.used() == 0);
+    ASSERT(a.num_free_ranges() == 1);
+    ASSERT(a.alloc(64).offset == 0);
+
+    // default constructed allocators start empty and grow on demand
+    RangeAllocator b;
+    ASSERT(b.capacity() == 0);
+    const auto r7 = b.alloc(5);
+    ASSERT(r7.offset == 0 && r7.size == 5);
+    ASSERT(b.capacity() == 8);
+
+    return 0;
+}